@@ -16,6 +16,7 @@
 #include <constants.h>
 
 #include "arith.h"
+#include "hyperedge_parser.h"
 
 // used to convert the default values of the compression to a string
 #define STRINGIFY( x) #x
@@ -34,14 +35,27 @@ static void print_usage(bool error) {
 	"   optional options:\n"
 	"    -f,--format        [format]         format of the RDF graph; keep empty to auto detect the format\n"
 	"                                        possible values: \"hyperedge\"\n"
+	"                                        files in the binary edge list format are detected automatically\n"
 	"       --overwrite                      overwrite if the output file exists\n"
 	"    -v,--verbose                        print advanced information\n"
+	"       --to-binary                      convert the input to the binary edge list format instead of compressing it\n"
+	"       --append        [graph]          append the edges of the input to the given compressed graph,\n"
+	"                                        the rules of the graph are reused\n"
 	"\n"
 	"   options to influence the resulting size and the runtime to browse the graph (optional):\n"
 	"       --max-rank      [rank]           maximum rank of edges, set to 0 to remove limit (default: " STR(DEFAULT_MAX_RANK) ")\n"
 	"       --monograms                      enable the replacement of monograms\n"
 	"       --factor        [factor]         number of blocks of a bit sequence that are grouped into a superblock (default: " STR(DEFAULT_FACTOR) ")\n"
 	"       --no-table                       do not add an extra table to speed up the decompression of the edges for an specific label\n"
+	"       --threads       [threads]        number of threads used for parsing and compressing,\n"
+	"                                        also used for the queries of `--query-file` (default: " STR(DEFAULT_THREADS) ")\n"
+	"       --max-memory    [MiB]            memory limit of the compression, the edges and the least frequent digrams\n"
+	"                                        are moved to temporary files if it is exceeded, 0 for no limit (default: " STR(DEFAULT_MAX_MEMORY) ")\n"
+	"       --partitions    [partitions]     number of partitions of the edges that are compressed in parallel,\n"
+	"                                        the grammars of the partitions are merged, so the compressed graph is often\n"
+	"                                        a few percent larger, `--max-memory` is shared by the partitions (default: " STR(DEFAULT_PARTITIONS) ")\n"
+	"       --batch         [digrams]        number of digrams without common labels that are replaced\n"
+	"                                        in each round of RePair, faster but compresses worse (default: " STR(DEFAULT_BATCH) ")\n"
 #ifdef RRR
     "    --rrr                               use bitsequences based on R. Raman, V. Raman, and S. S. Rao [experimental]\n"
     "                                        --factor can also be applied to this type of bit sequences\n"
@@ -77,6 +91,7 @@ static void print_usage(bool error) {
     "         --exact-query                  check if there is an edge containing exactly these nodes and no other.\n"
     "         --sort-result                  sort the resulting edges using quicksort.\n"
     "       --query-file                     input file with one line per query. For testing only.\n"
+    "                                        The queries are run in parallel by the number of threads set with `--threads`.\n"
 	"       --node-count                     returns the number of nodes in the graph\n"
 	"       --edge-labels                    returns the number of different edge labels in the graph\n"
 	;
@@ -96,6 +111,12 @@ enum opt {
 	OPT_C_MONOGRAMS,
 	OPT_C_FACTOR,
 	OPT_C_NO_TABLE,
+	OPT_C_THREADS,
+	OPT_C_MAX_MEMORY,
+	OPT_C_PARTITIONS,
+	OPT_C_BATCH,
+	OPT_C_TO_BINARY,
+	OPT_C_APPEND,
 #ifdef RRR
 	OPT_C_RRR,
 #endif
@@ -139,6 +160,8 @@ typedef struct {
 
 	// options for compression
 	CGraphCParams params;
+	bool to_binary;
+	const char* append; // compressed graph the edges are appended to
 
 	// options for reading
 	int command_count;
@@ -232,6 +255,12 @@ static int parse_args(int argc, char** argv, CGraphArgs* argd) {
 		{"monograms", no_argument, 0, OPT_C_MONOGRAMS},
 		{"factor", required_argument, 0, OPT_C_FACTOR},
 		{"no-table", no_argument, 0, OPT_C_NO_TABLE},
+		{"threads", required_argument, 0, OPT_C_THREADS},
+		{"max-memory", required_argument, 0, OPT_C_MAX_MEMORY},
+		{"partitions", required_argument, 0, OPT_C_PARTITIONS},
+		{"batch", required_argument, 0, OPT_C_BATCH},
+		{"to-binary", no_argument, 0, OPT_C_TO_BINARY},
+		{"append", required_argument, 0, OPT_C_APPEND},
 #ifdef RRR
 		{"rrr", no_argument, 0, OPT_C_RRR},
 #endif
@@ -261,6 +290,12 @@ static int parse_args(int argc, char** argv, CGraphArgs* argd) {
 	argd->params.monograms = DEFAULT_MONOGRAMS;
 	argd->params.factor = DEFAULT_FACTOR;
 	argd->params.nt_table = DEFAULT_NT_TABLE;
+	argd->params.threads = DEFAULT_THREADS;
+	argd->params.max_memory = DEFAULT_MAX_MEMORY;
+	argd->params.partitions = DEFAULT_PARTITIONS;
+	argd->params.batch = DEFAULT_BATCH;
+	argd->to_binary = false;
+	argd->append = NULL;
     argd->params.exist_query = DEFAULT_EXIST_QUERY;
     argd->params.exact_query = DEFAULT_EXACT_QUERY;
     argd->params.sort_result = DEFAULT_SORT_RESULT;
@@ -313,6 +348,50 @@ static int parse_args(int argc, char** argv, CGraphArgs* argd) {
 			check_mode(mode_compress, mode_read, true);
 			argd->params.nt_table = false;
 			break;
+		case OPT_C_THREADS:
+			// used for compressing and for reading
+			if(parse_optarg_int(&v) < 0 || v == 0) {
+				fprintf(stderr, "threads: expected positive integer\n");
+				return -1;
+			}
+
+			argd->params.threads = v;
+			break;
+		case OPT_C_MAX_MEMORY:
+			check_mode(mode_compress, mode_read, true);
+			if(parse_optarg_int(&v) < 0) {
+				fprintf(stderr, "max-memory: expected integer\n");
+				return -1;
+			}
+
+			argd->params.max_memory = v << 20;
+			break;
+		case OPT_C_PARTITIONS:
+			check_mode(mode_compress, mode_read, true);
+			if(parse_optarg_int(&v) < 0 || v <= 0) {
+				fprintf(stderr, "partitions: expected positive integer\n");
+				return -1;
+			}
+
+			argd->params.partitions = v;
+			break;
+		case OPT_C_BATCH:
+			check_mode(mode_compress, mode_read, true);
+			if(parse_optarg_int(&v) < 0 || v <= 0) {
+				fprintf(stderr, "batch: expected positive integer\n");
+				return -1;
+			}
+
+			argd->params.batch = v;
+			break;
+		case OPT_C_TO_BINARY:
+			check_mode(mode_compress, mode_read, true);
+			argd->to_binary = true;
+			break;
+		case OPT_C_APPEND:
+			check_mode(mode_compress, mode_read, true);
+			argd->append = optarg;
+			break;
 #ifdef RRR
 		case OPT_C_RRR:
 			check_mode(mode_compress, mode_read, true);
@@ -405,77 +484,18 @@ static int guess_format(const char* filename) {
 }
 
 #define MAX_LINE_LENGTH (8*LIMIT_MAX_RANK)  // With 8, it gives 1024 for a max_rank of 128.
-static int hyperedge_parse(const char* filename, int syntax, CGraphW* g) {
-    int res = -1;
 
-    bool err = false;
+// checks the magic of the binary edge list format
+static bool is_binary_edges(const char* filename) {
+	char magic[MAGIC_EDGES_LEN];
 
-    FILE* in_fd = fopen((const char*) filename, "r");
-    if(!in_fd)
-        return res;
-
-    char line[MAX_LINE_LENGTH];
-    CGraphNode n[LIMIT_MAX_RANK];
-    size_t cn = 0;
-    while (fgets(line, sizeof(line), in_fd) && !err) {
-        cn = 0;
-        // Process each line of the hyperedge file
-        // Split the line into individual items using strtok
-        char* token = strtok(line, " \t\n"); //Use empty space, tab, and newline as delimiter.
-        while (token != NULL) {
-            n[cn++] = strtoll(token, NULL, 10); // TODO: Get Endpointer??
-            if (cn == LIMIT_MAX_RANK)
-                return -1; //Allowed number of parameters are exceeded.
-            token = strtok(NULL, " \t\n");
-        }
-        if (cgraphw_add_edge(g, cn-1, n[0], (n + 1)) < 0) {
-            err = true;
-        }
-    }
+	FILE* f = fopen(filename, "rb");
+	if(!f)
+		return false;
 
-    fclose(in_fd);
-
-    if(!err)
-        res = 0;
-
-    return res;
-}
-
-#define MAX_LINE_LENGTH (8*LIMIT_MAX_RANK)  // With 8, it gives 1024 for a max_rank of 128.
-static int cornell_hyperedge_parse(const char* filename, int syntax, CGraphW* g) {
-    int res = -1;
-
-    bool err = false;
-    char line[MAX_LINE_LENGTH];
-    CGraphNode n[LIMIT_MAX_RANK];
-
-    FILE* edge_file = fopen((const char*) filename, "r");
-
-    if(!edge_file)
-        return res;
-
-    uint64_t cn = 0;
-    while (fgets(line, sizeof(line), edge_file) && !err) {
-        cn = 0;
-        // Process each line of the hyperedge file
-        // Split the line into individual items using strtok
-        char* token = strtok(line, " ,\t\n"); //Use empty space, tab, and newline as delimiter.
-        while (token != NULL) {
-            n[cn++] = strtoll(token, NULL, 0);
-            if (cn == LIMIT_MAX_RANK)
-                return -1; //Allowed number of parameters are exceeded.
-            token = strtok(NULL, " ,\t\n");
-        }
-        if (cgraphw_add_edge(g, cn,  cn, n) < 0) { // TODO: Label is always cn for this parser, because we need labels depending on the rank.
-            err = true;
-        }
-    }
-    fclose(edge_file);
-
-    if(!err)
-        res = 0;
-
-    return res;
+	bool res = fread(magic, MAGIC_EDGES_LEN, 1, f) == 1 && memcmp(magic, MAGIC_EDGES, MAGIC_EDGES_LEN) == 0;
+	fclose(f);
+	return res;
 }
 
 static int do_compress(const char* input, const char* output, const CGraphArgs* argd) {
@@ -512,6 +532,9 @@ static int do_compress(const char* input, const char* output, const CGraphArgs*
 		printf("- monograms: %s\n", argd->params.monograms ? "true" : "false");
 		printf("- factor: %d\n", argd->params.factor);
 		printf("- nt-table: %s\n", argd->params.nt_table ? "true" : "false");
+		printf("- max-memory: %zu MiB\n", argd->params.max_memory >> 20);
+		printf("- partitions: %d\n", argd->params.partitions);
+		printf("- batch: %d\n", argd->params.batch);
 #ifdef RRR
 		printf("- rrr: %s\n", argd->params.rrr ? "true" : "false");
 #endif
@@ -525,11 +548,30 @@ static int do_compress(const char* input, const char* output, const CGraphArgs*
 
 	int res = -1;
 
+	if(argd->append) {
+		if(argd->verbose)
+			printf("Loading compressed graph %s\n", argd->append);
+		if(cgraphw_load(g, argd->append) < 0) {
+			fprintf(stderr, "Failed to load compressed graph \"%s\".\n", argd->append);
+			goto exit_0;
+		}
+	}
+
+    if (is_binary_edges(input))
+    {
+        if(argd->verbose)
+            printf("Loading binary edge list %s\n", input);
+        if(cgraphw_add_edges_file(g, input) < 0) {
+            fprintf(stderr, "Failed to read file \"%s\".\n", input);
+            goto exit_0;
+        }
+    }
+    else
     if (syntax == syntaxes[0].syntax)
     {
         if(argd->verbose)
             printf("Parsing Cornell Hyperedge file %s\n", input);
-        if(cornell_hyperedge_parse(input, syntax, g) < 0) {
+        if(hyperedge_parse_file(input, HYPEREDGE_CORNELL, argd->params.threads, g) < 0) {
             fprintf(stderr, "Failed to read file \"%s\".\n", input);
             goto exit_0;
         }
@@ -539,12 +581,25 @@ static int do_compress(const char* input, const char* output, const CGraphArgs*
     {
         if(argd->verbose)
             printf("Parsing Hyperedge file %s\n", input);
-        if(hyperedge_parse(input, syntax, g) < 0) {
+        if(hyperedge_parse_file(input, HYPEREDGE_LABELED, argd->params.threads, g) < 0) {
             fprintf(stderr, "Failed to read file \"%s\".\n", input);
             goto exit_0;
         }
     }
 
+	if(argd->to_binary) {
+		if(argd->verbose)
+			printf("Writing binary edge list to %s\n", output);
+
+		if(cgraphw_write_edges(g, output) < 0) {
+			fprintf(stderr, "failed to write binary edge list\n");
+			goto exit_0;
+		}
+
+		res = 0;
+		goto exit_0;
+	}
+
 	if(argd->verbose)
 		printf("Applying repair compression\n");
 
@@ -827,61 +882,175 @@ bool do_search(CGraphR* g, CGraphRank rank, CGraphNode* nodes, bool exist_query,
     return result->len > 0;
 }
 
-void perform_search(CGraphR* g, CGraphRank rank, CGraphNode* nodes, bool exist_query, bool exact_query, bool sort_result, bool verbose)
+static void free_edges(EdgeList* ls)
 {
-    EdgeList ls = {0};
-    bool has_result = do_search(g, rank, nodes, exist_query, exact_query, sort_result, &ls);
+    for (size_t j = 0; j < ls->len; j++)
+    {
+        free(ls->data[j].nodes);
+    }
+    if(ls->data)
+        free(ls->data);
+}
 
+// prints the result of a search and frees the edges
+static void print_search_result(EdgeList* ls, bool has_result, bool exist_query, bool verbose)
+{
     if (exist_query)
     {
         printf("%d\n", has_result ? 1 : 0);
     }
     else
     {
-        printf("Found %zu results\n", ls.len);
+        printf("Found %zu results\n", ls->len);
         if (verbose)
         {
-            for(size_t i = 0; i < ls.len; i++) {
-                printf("%" PRId64, ls.data[i].nodes[0]);
-                for (CGraphRank j = 1; j < ls.data[i].rank; j++) {
-                    printf(", %" PRId64, ls.data[i].nodes[j]);
+            for(size_t i = 0; i < ls->len; i++) {
+                printf("%" PRId64, ls->data[i].nodes[0]);
+                for (CGraphRank j = 1; j < ls->data[i].rank; j++) {
+                    printf(", %" PRId64, ls->data[i].nodes[j]);
                 }
                 printf("\n");
             }
         }
+    }
+
+    free_edges(ls);
+}
+
+void perform_search(CGraphR* g, CGraphRank rank, CGraphNode* nodes, bool exist_query, bool exact_query, bool sort_result, bool verbose)
+{
+    EdgeList ls = {0};
+    bool has_result = do_search(g, rank, nodes, exist_query, exact_query, sort_result, &ls);
+    print_search_result(&ls, has_result, exist_query, verbose);
+}
+
+// Number of queries of a query file that are read and run together.
+#define QUERY_CHUNK_SIZE 65536
+
+typedef struct {
+    size_t len;
+    char* lines[QUERY_CHUNK_SIZE];
+    CGraphRank ranks[QUERY_CHUNK_SIZE];
+    CGraphQuery queries[QUERY_CHUNK_SIZE];
+    NodeList nodes; // nodes of all queries
+
+    bool exist_query;
+    EdgeList results[QUERY_CHUNK_SIZE];
+    bool found[QUERY_CHUNK_SIZE];
+} QueryChunk;
+
+// collects the edges of the queries, each query is only processed by one thread
+static int query_chunk_edge(size_t query, const CGraphEdge* e, void* ctx)
+{
+    QueryChunk* c = ctx;
+    c->found[query] = true;
+    if (c->exist_query)
+        return 1; // the first edge is enough
+
+    CGraphEdge copy = *e;
+    copy.nodes = malloc(e->rank * sizeof(CGraphNode));
+    if (!copy.nodes)
+        return -1;
+    memcpy(copy.nodes, e->nodes, e->rank * sizeof(CGraphNode));
+
+    edge_append(&c->results[query], &copy);
+    return 0;
+}
+
+// runs the queries of the chunk in parallel and prints their results in the order of the file
+static int query_chunk_run(CGraphR* g, QueryChunk* c, int first, bool exact_query, bool sort_result, bool verbose, int threads)
+{
+    size_t off = 0;
+    for (size_t i = 0; i < c->len; i++)
+    {
+        c->queries[i].rank = c->ranks[i];
+        c->queries[i].nodes = c->nodes.data + off;
+        off += c->ranks[i];
+    }
+    memset(c->results, 0, c->len * sizeof(*c->results));
+    memset(c->found, 0, c->len * sizeof(*c->found));
 
+    int res = cgraphr_edges_batch(g, c->len, c->queries, exact_query, threads, query_chunk_edge, c);
 
-        for (int j = 0; j < ls.len; j++)
+    for (size_t i = 0; i < c->len; i++)
+    {
+        EdgeList* ls = &c->results[i];
+        if (res == 0)
         {
-            free(ls.data[j].nodes);
+            printf("Query %zu: %s", first + i, c->lines[i]);
+            if (sort_result && ls->len > 1)
+                qsort(ls->data, ls->len, sizeof(CGraphEdge), cmp_edge);
+            print_search_result(ls, c->found[i], c->exist_query, verbose);
         }
-        if(ls.data)
-            free(ls.data);
-
+        else
+            free_edges(ls);
+        free(c->lines[i]);
     }
+
+    c->len = 0;
+    c->nodes.len = 0;
+    return res;
 }
 
-int perform_query_file(CGraphR* g, const char* query_file, bool exist_query, bool exact_query, bool sort_result, bool verbose)
+int perform_query_file(CGraphR* g, const char* query_file, bool exist_query, bool exact_query, bool sort_result, bool verbose, int threads)
 {
     FILE* in_fd = fopen((const char*) query_file, "r");
     if(!in_fd)
         return -1;
 
-    char line[MAX_LINE_LENGTH];
-    HyperedgeArg arg;
+    int res = -1;
+
+    char* line = malloc(MAX_LINE_LENGTH);
+    HyperedgeArg* arg = malloc(sizeof(*arg));
+    QueryChunk* chunk = calloc(1, sizeof(*chunk));
+    if (!line || !arg || !chunk)
+        goto exit_0;
+
+    chunk->exist_query = exist_query;
+
     int cn = 0;
-    while (fgets(line, sizeof(line), in_fd)) {
-        printf("Query %d: %s", cn, line);
-        if (parse_hyperedge_arg(line, &arg) < 0)
+    while (fgets(line, MAX_LINE_LENGTH, in_fd)) {
+        if (parse_hyperedge_arg(line, arg) < 0)
         {
+            // the queries before the wrong line are still answered
+            query_chunk_run(g, chunk, cn, exact_query, sort_result, verbose, threads);
             fprintf(stderr, "Parsing error of file.");
-            return -1;
+            goto exit_0;
         }
-        perform_search(g, arg.rank, arg.nodes, exist_query, exact_query, sort_result, verbose);
-        cn++;
+
+        chunk->lines[chunk->len] = strdup(line);
+        if (!chunk->lines[chunk->len])
+            goto exit_0;
+        chunk->ranks[chunk->len++] = arg->rank;
+        for (CGraphRank j = 0; j < arg->rank; j++)
+            node_append(&chunk->nodes, arg->nodes[j]);
+
+        if (chunk->len == QUERY_CHUNK_SIZE) {
+            if (query_chunk_run(g, chunk, cn, exact_query, sort_result, verbose, threads) < 0)
+                goto exit_0;
+            cn += QUERY_CHUNK_SIZE;
+        }
+    }
+
+    if (query_chunk_run(g, chunk, cn, exact_query, sort_result, verbose, threads) < 0)
+        goto exit_0;
+
+    res = 0;
+
+exit_0:
+    if (chunk) {
+        for (size_t i = 0; i < chunk->len; i++)
+            free(chunk->lines[i]);
+        if (chunk->nodes.data)
+            free(chunk->nodes.data);
+        free(chunk);
     }
+    if (arg)
+        free(arg);
+    if (line)
+        free(line);
     fclose(in_fd);
-    return 0;
+    return res;
 }
 
 static int do_read(const char* input, const CGraphArgs* argd) {
@@ -962,7 +1131,10 @@ static int do_read(const char* input, const CGraphArgs* argd) {
                 fprintf(stderr, "query file %s does not exists.", cmd->arg_str);
                 break;
             }
-            perform_query_file(g, cmd->arg_str, argd->params.exist_query, argd->params.exact_query, argd->params.sort_result, argd->verbose);
+            if(perform_query_file(g, cmd->arg_str, argd->params.exist_query, argd->params.exact_query, argd->params.sort_result, argd->verbose, argd->params.threads) < 0) {
+                fprintf(stderr, "failed to run the queries of %s\n", cmd->arg_str);
+                break;
+            }
             res = 0;
             break;
         }
@@ -0,0 +1,318 @@
+/**
+ * @file hyperedge_parser.c
+ * @author FR
+ */
+
+#include "hyperedge_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include <constants.h>
+
+#define PARSE_CHUNK_SIZE (1 << 25) // size of the chunks in bytes which are parsed by one thread
+
+typedef struct {
+	const char* begin;
+	const char* end;
+	HyperedgeSyntax syntax;
+
+	// parsed edges of this chunk in the layout of `cgraphw_add_edges`
+	size_t len;
+	size_t cap;
+	CGraphRank* ranks;
+	CGraphEdgeLabel* labels;
+
+	size_t nodes_len;
+	size_t nodes_cap;
+	CGraphNode* nodes;
+
+	int res;
+} ParseChunk;
+
+static inline bool is_separator(char c, HyperedgeSyntax syntax) {
+	return c == ' ' || c == '\t' || c == '\r' || (c == ',' && syntax == HYPEREDGE_CORNELL);
+}
+
+static inline int digit_value(char c) {
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return 16;
+}
+
+// Parses the integer at `*p` like `strtoll` with the given base (0 or 10) and moves `*p` behind it.
+// Values whose magnitude exceeds `INT64_MAX` are rejected.
+static bool scan_int(const char** p, const char* end, int base, int64_t* value) {
+	const char* s = *p;
+
+	bool neg = false;
+	if(s < end && (*s == '+' || *s == '-')) {
+		neg = *s == '-';
+		s++;
+	}
+
+	if(base == 0) {
+		if(end - s > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X') && digit_value(s[2]) < 16) {
+			base = 16;
+			s += 2;
+		}
+		else if(s < end && s[0] == '0')
+			base = 8;
+		else
+			base = 10;
+	}
+
+	const char* start = s;
+	uint64_t v = 0;
+	for(; s < end; s++) {
+		int d = digit_value(*s);
+		if(d >= base)
+			break;
+		if(v > ((uint64_t) INT64_MAX - d) / base)
+			return false; // the value does not fit into `int64_t`
+		v = v * base + d;
+	}
+
+	if(s == start)
+		return false;
+
+	*value = neg ? -(int64_t) v : (int64_t) v;
+	*p = s;
+	return true;
+}
+
+static int chunk_add_node(ParseChunk* c, CGraphNode node) {
+	if(c->nodes_len == c->nodes_cap) {
+		size_t cap = c->nodes_cap == 0 ? 1024 : 2 * c->nodes_cap;
+		CGraphNode* tmp = realloc(c->nodes, cap * sizeof(*tmp));
+		if(!tmp)
+			return -1;
+
+		c->nodes_cap = cap;
+		c->nodes = tmp;
+	}
+
+	c->nodes[c->nodes_len++] = node;
+	return 0;
+}
+
+static int chunk_add_edge(ParseChunk* c, CGraphRank rank, CGraphEdgeLabel label) {
+	if(c->len == c->cap) {
+		size_t cap = c->cap == 0 ? 512 : 2 * c->cap;
+		CGraphRank* ranks = realloc(c->ranks, cap * sizeof(*ranks));
+		if(!ranks)
+			return -1;
+		c->ranks = ranks;
+
+		CGraphEdgeLabel* labels = realloc(c->labels, cap * sizeof(*labels));
+		if(!labels)
+			return -1;
+		c->labels = labels;
+
+		c->cap = cap;
+	}
+
+	c->ranks[c->len] = rank;
+	c->labels[c->len] = label;
+	c->len++;
+	return 0;
+}
+
+static void chunk_destroy(ParseChunk* c) {
+	if(c->ranks)
+		free(c->ranks);
+	if(c->labels)
+		free(c->labels);
+	if(c->nodes)
+		free(c->nodes);
+}
+
+// Every line is an edge, including empty lines.
+static int chunk_parse(ParseChunk* c) {
+	int base = c->syntax == HYPEREDGE_CORNELL ? 0 : 10;
+
+	const char* p = c->begin;
+	const char* end = c->end;
+	while(p < end) {
+		size_t values = 0;
+		CGraphEdgeLabel label = 0;
+
+		while(true) {
+			while(p < end && is_separator(*p, c->syntax))
+				p++;
+			if(p == end || *p == '\n')
+				break;
+
+			int64_t v;
+			if(!scan_int(&p, end, base, &v))
+				return -1;
+			if(p < end && *p != '\n' && !is_separator(*p, c->syntax))
+				return -1; // the value is followed by an invalid character
+
+			if(++values == LIMIT_MAX_RANK)
+				return -1; // allowed number of values is exceeded
+
+			if(c->syntax == HYPEREDGE_LABELED && values == 1)
+				label = v;
+			else if(chunk_add_node(c, v) < 0)
+				return -1;
+		}
+
+		if(c->syntax == HYPEREDGE_CORNELL) {
+			// the label is always the rank for this syntax, because labels depending on the rank are needed
+			if(chunk_add_edge(c, values, values) < 0)
+				return -1;
+		}
+		else {
+			if(values == 0) // the label is missing
+				return -1;
+			if(chunk_add_edge(c, values - 1, label) < 0)
+				return -1;
+		}
+
+		if(p < end) // skip the newline
+			p++;
+	}
+
+	return 0;
+}
+
+static void* chunk_parse_thread(void* arg) {
+	ParseChunk* c = arg;
+	c->res = chunk_parse(c);
+	return NULL;
+}
+
+static int parse_data(const char* data, size_t size, HyperedgeSyntax syntax, int threads, CGraphW* g) {
+	ParseChunk* chunks = calloc(threads, sizeof(*chunks));
+	if(!chunks)
+		return -1;
+	pthread_t* tids = malloc(threads * sizeof(*tids));
+	if(!tids) {
+		free(chunks);
+		return -1;
+	}
+	bool* started = malloc(threads * sizeof(*started));
+	if(!started) {
+		free(tids);
+		free(chunks);
+		return -1;
+	}
+
+	int res = 0;
+
+	// The chunks are parsed in rounds of `threads` chunks,
+	// the edges of a round are added to the graph in the order of the chunks.
+	size_t pos = 0;
+	while(pos < size && res == 0) {
+		int n = 0;
+		for(; n < threads && pos < size; n++) {
+			size_t end = pos + PARSE_CHUNK_SIZE;
+			if(end >= size)
+				end = size;
+			else { // the chunk ends after the next newline
+				const char* nl = memchr(data + end, '\n', size - end);
+				end = nl ? (size_t) (nl - data) + 1 : size;
+			}
+
+			memset(&chunks[n], 0, sizeof(chunks[n]));
+			chunks[n].begin = data + pos;
+			chunks[n].end = data + end;
+			chunks[n].syntax = syntax;
+			pos = end;
+		}
+
+		// the first chunk is parsed by the calling thread
+		for(int i = 1; i < n; i++)
+			started[i] = pthread_create(&tids[i], NULL, chunk_parse_thread, &chunks[i]) == 0;
+		chunk_parse_thread(&chunks[0]);
+
+		for(int i = 0; i < n; i++) {
+			if(i > 0) {
+				if(started[i])
+					pthread_join(tids[i], NULL);
+				else // parse the chunk in this thread if no thread could be created
+					chunk_parse_thread(&chunks[i]);
+			}
+
+			ParseChunk* c = &chunks[i];
+			if(res == 0 && c->res < 0)
+				res = -1;
+			if(res == 0 && c->len > 0 && cgraphw_add_edges(g, c->len, c->ranks, c->labels, c->nodes, 0) < 0)
+				res = -1;
+
+			chunk_destroy(c);
+		}
+	}
+
+	free(started);
+	free(tids);
+	free(chunks);
+	return res;
+}
+
+int hyperedge_parse_file(const char* path, HyperedgeSyntax syntax, int threads, CGraphW* g) {
+	int res = -1;
+
+	if(threads < 1)
+		threads = 1;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) < 0)
+		goto exit_0;
+
+	size_t size = st.st_size;
+	if(size == 0) { // no edges
+		res = 0;
+		goto exit_0;
+	}
+
+#ifdef USE_MMAP
+	char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		goto exit_0;
+	madvise(data, size, MADV_SEQUENTIAL);
+#else
+	char* data = malloc(size);
+	if(!data)
+		goto exit_0;
+
+	size_t read_len = 0;
+	while(read_len < size) {
+		ssize_t r = read(fd, data + read_len, size - read_len);
+		if(r <= 0)
+			goto exit_1;
+		read_len += r;
+	}
+#endif
+
+	res = parse_data(data, size, syntax, threads, g);
+
+#ifndef USE_MMAP
+exit_1:
+	free(data);
+#else
+	munmap(data, size);
+#endif
+exit_0:
+	close(fd);
+	return res;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file hyperedge_parser.h
+ * @author FR
+ */
+
+#ifndef HYPEREDGE_PARSER_H
+#define HYPEREDGE_PARSER_H
+
+#include <cgraph.h>
+
+typedef enum {
+	// Cornell hyperedge files: the nodes of an edge are separated by commas, spaces or tabs,
+	// the rank of the edge is used as label.
+	HYPEREDGE_CORNELL,
+	// The first value is the label of the edge followed by the nodes, separated by spaces or tabs.
+	HYPEREDGE_LABELED,
+} HyperedgeSyntax;
+
+// Adds every line of the file as an edge to the graph, the edges are added in the order of the file.
+// The file is split into chunks of lines which are parsed by `threads` threads.
+int hyperedge_parse_file(const char* path, HyperedgeSyntax syntax, int threads, CGraphW* g);
+
+#endif
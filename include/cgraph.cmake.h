@@ -47,6 +47,22 @@ typedef struct {
 
     // Add the extra NT table
     bool nt_table;
+
+    // Number of threads used for the compression
+    int threads;
+
+    // Memory limit of the compression in bytes, set to 0 to remove the limit.
+    // If the limit is exceeded, the edges and the least frequent digrams are moved to temporary files.
+    size_t max_memory;
+
+    // Number of partitions of the edges which are compressed independently and merged afterwards.
+    // More partitions allow to use more threads, but the compression ratio may be slightly worse.
+    // The memory limit is shared by the partitions.
+    int partitions;
+
+    // Number of digrams replaced in each round of RePair. The digrams of a round do not share labels,
+    // so they can be replaced together. More digrams per round are faster, but may compress worse.
+    int batch;
 #ifdef RRR
     // Using bitsequences of type RRR
     bool rrr;
@@ -104,6 +120,25 @@ typedef struct {
     CGraphNode* nodes;
 } CGraphEdge;
 
+/**
+ * Type used for a query of `cgraphr_edges_batch`, the parameters are the same as for `cgraphr_edges`.
+ */
+typedef struct {
+    /* Number of nodes of the query. */
+    CGraphRank rank;
+
+    /* The nodes of the query. */
+    const CGraphNode* nodes;
+} CGraphQuery;
+
+/**
+ * Callback for the edges found by `cgraphr_edges_batch`.
+ * The edge and its nodes are only valid during the call.
+ * Returns a negative value to abort the batch, a positive value to skip the remaining edges of the query
+ * or 0 to continue.
+ */
+typedef int (*CGraphEdgeCallback)(size_t query, const CGraphEdge* e, void* ctx);
+
 /**
  * Creates a handler to compress an existing graph.
  * If the handler could not be created, `NULL` is returned.
@@ -136,10 +171,73 @@ void cgraphw_destroy(CGraphW* g);
 CGRAPH_API
 int cgraphw_add_edge(CGraphW* g, const CGraphRank rank, CGraphRank label, const CGraphNode* nodes);
 
+/**
+ * Adds a batch of edges to the graph.
+ * The edges are given in a CSR-like layout: the i-th edge has the rank `ranks[i]`
+ * and the label `labels[i]`, its nodes follow the nodes of the (i-1)-th edge in `nodes`.
+ * So `nodes` contains `ranks[0] + ... + ranks[count - 1]` nodes.
+ * If an error occurs, none of the edges of the batch is added.
+ *
+ * @param g Handler of the graph compressor.
+ * @param count Number of edges in the batch.
+ * @param ranks Ranks of the edges.
+ * @param labels Labels of the edges.
+ * @param nodes Nodes of all edges.
+ * @param capacity_hint Expected total number of edges of the graph to reserve memory at once, 0 if unknown.
+ * @return 0, if no errors occurred, otherwise -1.
+ */
+CGRAPH_API
+int cgraphw_add_edges(CGraphW* g, size_t count, const CGraphRank* ranks, const CGraphEdgeLabel* labels, const CGraphNode* nodes, size_t capacity_hint);
+
+
+/**
+ * Adds all edges of a file in the binary edge list format to the graph.
+ * The file is mapped into memory and the edges are added without any parsing.
+ *
+ * The binary edge list format stores all integers as 64-bit little endian values:
+ * the magic "CGEDGE1\0" (8 bytes), the number of edges `n`, the number of nodes `m`
+ * of all edges (sum of the ranks), followed by `n` ranks, `n` labels and `m` nodes.
+ * This is the layout of `cgraphw_add_edges`.
+ *
+ * @param g Handler of the graph compressor.
+ * @param path File in the binary edge list format.
+ * @return 0, if no errors occurred, otherwise -1, also if the file has a wrong format.
+ */
+CGRAPH_API
+int cgraphw_add_edges_file(CGraphW* g, const char* path);
+
+/**
+ * Writes all edges added to the graph so far in the binary edge list format, see `cgraphw_add_edges_file`.
+ * The edges are written in the order they were added.
+ * This requires that the graph has not been compressed yet.
+ * If a file exists at the given path, it will be overwritten.
+ *
+ * @param g Handler of the graph compressor.
+ * @param path Destination of the edge list.
+ * @return 0, if no errors occurred, otherwise -1.
+ */
+CGRAPH_API
+int cgraphw_write_edges(CGraphW* g, const char* path);
+
+/**
+ * Loads a compressed graph, so the edges added to the graph are appended to it.
+ * The rules of the compressed graph are reused and RePair only runs on the edges of its start symbol
+ * and the added edges, which is faster than compressing all edges again.
+ * The edges of the loaded graph are not partitioned, so the parameter `partitions` is ignored.
+ * Only one graph can be loaded and this must be done before compressing the graph.
+ * Afterwards, the edges cannot be written with `cgraphw_write_edges`.
+ *
+ * @param g Handler of the graph compressor.
+ * @param path Path of the compressed graph.
+ * @return 0, if no errors occurred, otherwise -1.
+ */
+CGRAPH_API
+int cgraphw_load(CGraphW* g, const char* path);
 
 /**
  * Sets the compression parameters.
  * Must be done before compressing or writing the graph.
+ * The memory limit only applies to the edges added afterwards, so it should be set before adding edges.
  *
  * @param g Handler of the graph compressor.
  * @param p Parameters for the compression.
@@ -175,6 +273,9 @@ int cgraphw_write(CGraphW* g, const char* path, bool verbose);
  * Creates a handler for a file of a compressed graph.
  * If the file was not read correctly, e.g.
  * because the file contains wrong data, `NULL` is returned.
+ * The queries of one handler can be run by several threads at the same time, the file is only mapped once.
+ * Changes of the graph, i.e. `cgraphr_add_edge`, `cgraphr_remove_edge` and `cgraphr_compact_finish`,
+ * must not run concurrently with other calls on the same handler.
  *
  * @param path Path of the graph file; can be absolute or relative.
  * @return Handler used for the calls to libcgraph.
@@ -253,6 +354,26 @@ bool cgraphr_edges_next(CGraphEdgeIterator* it, CGraphEdge* e);
 CGRAPH_API
 void cgraphr_edges_finish(CGraphEdgeIterator* it);
 
+/**
+ * Determines the edges of several queries like `cgraphr_edges` using several threads.
+ * Queries with the same first node share the edges of the start symbol at this node,
+ * so these are only decoded once.
+ * The callback is called for each edge of each query with the index of the query.
+ * All edges of a query are passed by the same thread, but the queries are processed in no specific order
+ * and the callback is called concurrently by different threads.
+ *
+ * @param g Handler of the graph reader.
+ * @param count Number of queries.
+ * @param queries The queries.
+ * @param exact_query Edges must have the rank of the query.
+ * @param threads Number of threads.
+ * @param cb Callback for the found edges.
+ * @param ctx Context passed to the callback.
+ * @return 0, if no errors occurred, otherwise -1, also if the callback aborted the batch.
+ */
+CGRAPH_API
+int cgraphr_edges_batch(CGraphR* g, size_t count, const CGraphQuery* queries, bool exact_query, int threads, CGraphEdgeCallback cb, void* ctx);
+
 /**
  * Checks if the given edge exists in the graph.
  * 
@@ -276,4 +397,60 @@ bool cgraphr_edge_exists(CGraphR* g, CGraphRank rank, const CGraphNode* nodes, b
 CGRAPH_API
 CGraphEdgeIterator* cgraphr_edges_all(CGraphR* g);
 
+/**
+ * Adds an edge to the graph without compressing it again.
+ * The edge is kept in memory and returned by the queries together with the edges of the compressed graph.
+ * The nodes and the label may be new to the graph.
+ * The edges and the graph must not be changed while an edge iterator of the graph is used.
+ *
+ * @param g Handler of the graph reader.
+ * @param rank Number of nodes of the edge.
+ * @param label Label of the edge.
+ * @param nodes Nodes of the edge.
+ * @return 0, if no errors occurred, otherwise -1.
+ */
+CGRAPH_API
+int cgraphr_add_edge(CGraphR* g, CGraphRank rank, CGraphEdgeLabel label, const CGraphNode* nodes);
+
+/**
+ * Removes an edge with exactly this label and these nodes in this order from the graph.
+ * Edges added with `cgraphr_add_edge` and edges of the start symbol of the compressed graph can be removed,
+ * but not edges that are only produced by a rule of the grammar.
+ * While a compaction is running, only edges added after it was started can be removed.
+ *
+ * @param g Handler of the graph reader.
+ * @param rank Number of nodes of the edge.
+ * @param label Label of the edge.
+ * @param nodes Nodes of the edge.
+ * @return 0, if the edge was removed, otherwise -1.
+ */
+CGRAPH_API
+int cgraphr_remove_edge(CGraphR* g, CGraphRank rank, CGraphEdgeLabel label, const CGraphNode* nodes);
+
+/**
+ * Starts to compress the graph with the added and removed edges into a new file in a separate thread.
+ * The rules of the current graph are reused like with `cgraphw_load`.
+ * The graph can still be queried and changed during the compaction,
+ * the compaction is completed with `cgraphr_compact_finish`.
+ * The destination must not be the file of the graph.
+ *
+ * @param g Handler of the graph reader.
+ * @param path Destination of the compressed graph.
+ * @param params Parameters for the compression, `NULL` for the default parameters.
+ * @return 0, if the compaction was started, otherwise -1, also if a compaction is already running.
+ */
+CGRAPH_API
+int cgraphr_compact(CGraphR* g, const char* path, const CGraphCParams* params);
+
+/**
+ * Waits for the compaction started with `cgraphr_compact`.
+ * On success, the handler reads the new file afterwards and only keeps the edges changed during the compaction in memory.
+ * Otherwise, the handler still reads the old file with all changes.
+ *
+ * @param g Handler of the graph reader.
+ * @return 0, if the compaction succeeded, otherwise -1.
+ */
+CGRAPH_API
+int cgraphr_compact_finish(CGraphR* g);
+
 #endif
@@ -59,10 +59,10 @@ FileReader* filereader_init(const char* path) {
 		r->cache[i].block = -1;
 	r->cache_list_head = -1;
 	r->cache_list_tail = -1;
+	pthread_mutex_init(&r->cache_lock, NULL);
 #endif
 
 	r->bitlen = 8 * size;
-	r->bitpos = 0;
 
 	return r;
 
@@ -78,6 +78,8 @@ err_0:
 void filereader_close(FileReader* r) {
 #ifdef USE_MMAP
 	munmap(r->mm, r->bitlen / 8); // unmapping the file
+#else
+	pthread_mutex_destroy(&r->cache_lock);
 #endif
 
 	close(r->fd); // closing the file descriptor
@@ -105,12 +107,12 @@ void reader_bitpos(Reader* r, FileOff pos) {
 	if(unlikely(pos < 0 || pos >= r->r->bitlen))
 		panic("illegal bit offset %" PRIu64 " with bit length %" PRIu64, pos, r->r->bitlen);
 
-	r->r->bitpos = pos;
+	r->bitpos = pos;
 }
 
 static inline void check_remaining(Reader* r, FileOff n) {
-	if(unlikely(r->r->bitpos + n > r->r->bitlen))
-		panic("trying to read %" PRIu64 " bits but only %" PRIu64 " are available", n, r->r->bitlen - r->r->bitpos);
+	if(unlikely(r->bitpos + n > r->r->bitlen))
+		panic("trying to read %" PRIu64 " bits but only %" PRIu64 " are available", n, r->r->bitlen - r->bitpos);
 }
 
 #ifndef USE_MMAP
@@ -234,6 +236,8 @@ static inline void read_bytes(Reader* r, void* data, FileOff byteindex, size_t n
 	FileOff block = byteindex / CACHE_BLOCK_SIZE;
 	size_t block_index = byteindex % CACHE_BLOCK_SIZE;
 
+	pthread_mutex_lock(&fr->cache_lock);
+
 	const uint8_t* block_buf = read_block(fr, block);
 
 	size_t read_size = MIN(CACHE_BLOCK_SIZE - block_index, nbytes);
@@ -247,7 +251,12 @@ static inline void read_bytes(Reader* r, void* data, FileOff byteindex, size_t n
 		memcpy(data + read_size, block_buf, copy_size);
 		read_size += copy_size;
 	}
+
+	pthread_mutex_unlock(&fr->cache_lock);
 }
+
+// Each thread has its own buffer for the data returned by `reader_read`.
+static _Thread_local uint8_t read_buf[BUFFER_SIZE];
 #endif
 
 static inline const uint8_t* get_bytes(Reader* r, size_t byte_pos, size_t n) {
@@ -258,9 +267,9 @@ static inline const uint8_t* get_bytes(Reader* r, size_t byte_pos, size_t n) {
 		if(n > BUFFER_SIZE)
 			panic("number of bytes (%zu) exceeds the maximum buffer size (%d)", n, BUFFER_SIZE);
 
-		data = r->r->read_buf;
+		data = read_buf;
 		if(n > 0)
-			read_bytes(r, data, byteindex, n);
+			read_bytes(r, data, byte_pos, n);
 	#endif
 
 	return data;
@@ -269,7 +278,7 @@ static inline const uint8_t* get_bytes(Reader* r, size_t byte_pos, size_t n) {
 const uint8_t* reader_read(Reader* r, size_t n) {
 	check_remaining(r, 8 * n);
 
-	FileOff bitpos = r->r->bitpos;
+	FileOff bitpos = r->bitpos;
 	FileOff byteindex = bitpos / 8;
 	FileOff bitoff = bitpos % 8;
 
@@ -278,15 +287,15 @@ const uint8_t* reader_read(Reader* r, size_t n) {
 
 	const uint8_t* data = get_bytes(r, byteindex, n);
 
-	r->r->bitpos += 8 * n;
+	r->bitpos += 8 * n;
 	return data;
 }
 
 bool reader_readbit(Reader* r) {
 	check_remaining(r, 1);
 
-	FileOff byteindex = r->r->bitpos / 8;
-	FileOff bitoff = r->r->bitpos % 8;
+	FileOff byteindex = r->bitpos / 8;
+	FileOff bitoff = r->bitpos % 8;
 
 	bool b;
 #ifdef USE_MMAP
@@ -298,7 +307,7 @@ bool reader_readbit(Reader* r) {
 	b = ((byte >> (8 - bitoff - 1)) & 1) == 1;
 #endif
 
-	r->r->bitpos++;
+	r->bitpos++;
 	return b;
 }
 
@@ -352,7 +361,7 @@ uint64_t reader_readint(Reader* r, int bits) {
 
 	check_remaining(r, bits);
 
-	FileOff pos = r->r->bitpos;
+	FileOff pos = r->bitpos;
 	FileOff byte_pos = pos / 8;
 	int bitoff = pos % 8;
 	int byte_len = BYTE_LEN(pos + bits) - byte_pos;
@@ -377,7 +386,7 @@ uint64_t reader_readint(Reader* r, int bits) {
 			}
 		}
 
-		r->r->bitpos = pos + bits;
+		r->bitpos = pos + bits;
 		return res;
 	}
 
@@ -404,18 +413,18 @@ uint64_t reader_readint(Reader* r, int bits) {
 		res = uint_extract(val, shift, bits);
 	}
 
-	r->r->bitpos = pos + bits;
+	r->bitpos = pos + bits;
 	return res;
 }
 
 uint8_t reader_readbyte(Reader* r) {
 	check_remaining(r, 8);
 
-	FileOff bitpos = r->r->bitpos;
+	FileOff bitpos = r->bitpos;
 	FileOff byteindex = bitpos / 8;
 	FileOff bitoff = bitpos % 8;
 
-	r->r->bitpos += 8;
+	r->bitpos += 8;
 
 	if(bitoff == 0) {
 #ifdef USE_MMAP
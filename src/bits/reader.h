@@ -13,6 +13,8 @@
 typedef uint64_t FileOff;
 
 #ifndef USE_MMAP
+#include <pthread.h>
+
 #define CACHE_BLOCK_SIZE 512
 #define CACHE_CAPACITY 256 // 512 * 0.75 * 256 equals around 100kb maximum cache
 #define BUFFER_SIZE 8128
@@ -38,19 +40,23 @@ typedef struct {
 	int cache_list_head;
 	int cache_list_tail;
 
-	uint8_t read_buf[BUFFER_SIZE];
+	pthread_mutex_t cache_lock; // the cache is shared by the readers of all threads
 #endif
 
 	FileOff bitlen;
-	FileOff bitpos;
 } FileReader;
 
 FileReader* filereader_init(const char* path);
 void filereader_close(FileReader* fr);
 
+// The read position is stored in the reader and not in the shared file reader,
+// so different readers of the same file can be used by different threads.
+// Readers stored in the structures of the graph are copied before reading,
+// so the structures are not modified by queries.
 typedef struct {
 	FileReader* r;
 	FileOff bitoff;
+	FileOff bitpos; // absolute position in the file
 } Reader;
 
 void reader_initf(FileReader* fr, Reader* r, FileOff byte_off);
@@ -7,22 +7,65 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <cgraph.h>
 #include <constants.h>
 #include <reader.h>
 #include <grammar.h>
 #include <bitsequence_r.h>
+#include <startsymbol.h>
+#include <delta.h>
+#include <arith.h>
 #include "panic.h"
+#include "cgraphw_internal.h"
+
+// Parameters and result of a compaction, which is run in a separate thread.
+typedef struct {
+	char* src; // path of the compressed graph the delta belongs to
+	char* dst;
+	CGraphCParams params;
+	bool default_params; // `params` is not set and the default parameters are used
+
+	// added edges in the layout of `cgraphw_add_edges`
+	size_t count;
+	CGraphRank* ranks;
+	CGraphEdgeLabel* labels;
+	CGraphNode* nodes;
+
+	// sorted ids of the removed edges of the start symbol
+	uint64_t* removed;
+	size_t removed_len;
+
+	int res;
+} CompactJob;
 
 // Internal struct for the handler of libcgraph.
 // This contains the file readers and the readers for the grammar and the dictionary.
 typedef struct {
 	FileReader* r;
 	GrammarReader* gr;
+	char* path;
+
+	// edges added and removed after the graph was compressed
+	Delta delta;
+
+	struct {
+		bool running;
+		pthread_t thread;
+		CompactJob* job;
+		uint64_t gen; // the edges of the delta before this generation are contained in the compacted graph
+	} compact;
 } GraphReaderImpl;
 
-CGraphR* cgraphr_init(const char* path) {
+// Internal struct for the edge iterator, the edges of the grammar are followed by the added edges.
+typedef struct {
+	GrammarNeighborhood nb;
+	bool in_delta;
+	DeltaIterator delta;
+} EdgeIteratorImpl;
+
+static GrammarReader* cgraphr_open(const char* path, FileReader** fr) {
 	// check if graph file is readable
 	if(access(path, F_OK | R_OK) != 0) {
 		perror(path);
@@ -30,13 +73,13 @@ CGraphR* cgraphr_init(const char* path) {
 	}
 
 	// open the bit reader for the graph file
-	FileReader* fr = filereader_init(path);
-	if(!fr)
+	*fr = filereader_init(path);
+	if(!*fr)
 		return NULL;
 
 	// initialize the grammar reader with an subreader
 	Reader r;
-	reader_initf(fr, &r, 0);
+	reader_initf(*fr, &r, 0);
 
 	const uint8_t* magic = reader_read(&r, MAGIC_GRAPH_LEN);
 	if(memcmp(magic, MAGIC_GRAPH, MAGIC_GRAPH_LEN) != 0)
@@ -47,51 +90,135 @@ CGraphR* cgraphr_init(const char* path) {
 
 	FileOff offgrammar = MAGIC_GRAPH_LEN + nbytes;
 
-	reader_initf(fr, &r, offgrammar);
+	reader_initf(*fr, &r, offgrammar);
 	GrammarReader* gr = grammar_init(&r);
 	if(!gr)
 		goto err0;
 
-	// initialize the dict reader with an subreader
+	return gr;
+
+err0:
+	filereader_close(*fr);
+	return NULL;
+}
+
+CGraphR* cgraphr_init(const char* path) {
+	FileReader* fr;
+	GrammarReader* gr = cgraphr_open(path, &fr);
+	if(!gr)
+		return NULL;
 
 	GraphReaderImpl* g = malloc(sizeof(*g));
 	if(!g)
+		goto err0;
+
+	g->path = strdup(path);
+	if(!g->path)
 		goto err1;
 
 	g->r = fr;
 	g->gr = gr;
+	delta_init(&g->delta);
+	g->compact.running = false;
+	g->compact.job = NULL;
+	g->compact.gen = 0;
 
 	return (CGraphR*) g;
 
 err1:
-	grammar_destroy(gr);
+	free(g);
 err0:
+	grammar_destroy(gr);
 	filereader_close(fr);
 	return NULL;
 }
 
+static void compact_job_destroy(CompactJob* job) {
+	free(job->src);
+	free(job->dst);
+	free(job->ranks);
+	free(job->labels);
+	free(job->nodes);
+	free(job->removed);
+	free(job);
+}
+
 void cgraphr_destroy(CGraphR* g) {
 	GraphReaderImpl* gi = (GraphReaderImpl*) g;
 
-	filereader_close(gi->r);
+	// the result of a running compaction is discarded
+	if(gi->compact.running)
+		pthread_join(gi->compact.thread, NULL);
+	if(gi->compact.job)
+		compact_job_destroy(gi->compact.job);
+
 	grammar_destroy(gi->gr);
+	filereader_close(gi->r);
+	delta_destroy(&gi->delta);
+	free(gi->path);
 	free(gi);
 }
 
 size_t cgraphr_node_count(CGraphR* g) {
-	return ((GraphReaderImpl*) g)->gr->node_count;
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+	return MAX(gi->gr->node_count, gi->delta.node_count);
 }
 
 size_t cgraphr_edge_label_count(CGraphR* g) {
-	return ((GraphReaderImpl*) g)->gr->rules->first_nt;
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+	return MAX(gi->gr->rules->first_nt, gi->delta.label_count);
+}
+
+// Checks if the nodes of the query exist, the nodes may only exist in the delta.
+static bool cgraphr_nodes_exist(GraphReaderImpl* gi, CGraphRank rank, const CGraphNode* nodes) {
+	uint64_t node_count = cgraphr_node_count((CGraphR*) gi);
+	for(int i = 0; i < rank; i++) {
+		if(nodes[i] != CGRAPH_NODES_ALL && (nodes[i] < 0 || nodes[i] >= node_count))
+			return false; // node does not exist nor is wildcard.
+	}
+	return true;
+}
+
+// Checks if the nodes of the query exist in the grammar, otherwise only the delta contains matching edges.
+static bool cgraphr_nodes_in_grammar(GraphReaderImpl* gi, CGraphRank rank, const CGraphNode* nodes) {
+	for(int i = 0; i < rank; i++) {
+		if(nodes[i] != CGRAPH_NODES_ALL && nodes[i] >= gi->gr->node_count)
+			return false;
+	}
+	return true;
+}
+
+// The edges of the start symbol are taken from `row` if it is not NULL, see `grammar_neighborhood_row`.
+static void cgraphr_neighborhood(GraphReaderImpl* gi, const StartSymbolRow* row, int query_type, CGraphRank rank, const CGraphNode* nodes, EdgeIteratorImpl* it) {
+	if(!nodes || cgraphr_nodes_in_grammar(gi, rank, nodes)) {
+		if(row)
+			grammar_neighborhood_row(gi->gr, row, query_type, rank, nodes, &it->nb);
+		else
+			grammar_neighborhood(gi->gr, query_type, rank, nodes, &it->nb);
+		it->nb.delta = &gi->delta;
+	}
+	else
+		it->nb.has_next = false;
+
+	it->in_delta = false;
+	delta_iter(&gi->delta, query_type, rank, nodes, &it->delta);
+}
+
+// Determines the next edge of the grammar and afterwards of the delta like `grammar_neighborhood_next`.
+static int cgraphr_neighborhood_next(EdgeIteratorImpl* it, CGraphEdge* e) {
+	if(!it->in_delta) {
+		int res = grammar_neighborhood_next(&it->nb, e);
+		if(res != 0)
+			return res;
+		it->in_delta = true;
+	}
+	return delta_iter_next(&it->delta, e) ? 1 : 0;
 }
 
 
 bool cgraphr_edges_next(CGraphEdgeIterator* it, CGraphEdge* e) {
-	CGraphEdge t;
-    CGraphNode nodes[LIMIT_MAX_RANK];
-    t.nodes = nodes;
-	switch(grammar_neighborhood_next((GrammarNeighborhood*) it, &t)) {
+	CGraphEdge t; // the nodes of `t` belong to the iterator, so they are copied
+	switch(cgraphr_neighborhood_next((EdgeIteratorImpl*) it, &t)) {
 	case 1:
 		if(e) {
 			e->label = t.label;
@@ -113,33 +240,23 @@ bool cgraphr_edges_next(CGraphEdgeIterator* it, CGraphEdge* e) {
 }
 
 void cgraphr_edges_finish(CGraphEdgeIterator* it) {
-	grammar_neighborhood_finish((GrammarNeighborhood*) it);
+	grammar_neighborhood_finish(&((EdgeIteratorImpl*) it)->nb);
 	free(it);
 }
 
 bool cgraphr_edge_exists(CGraphR* g, CGraphRank rank, const CGraphNode* nodes, bool exact_query, bool no_node_order) {
 	GraphReaderImpl* gi = (GraphReaderImpl*) g;
 
-    for (int i = 0; i < rank; i++)
-    {
-        if (nodes[i] != CGRAPH_NODES_ALL && (nodes[i] < 0 || nodes[i] >= gi->gr->node_count))
-            return false; // node[i] does not exists
-    }
+	if(!cgraphr_nodes_exist(gi, rank, nodes))
+		return false;
 	//if(label < 0 || label >= gi->gr->rules->first_nt) // label does not exist
 	//	return false;
 
-	GrammarNeighborhood nb;
-    if (exact_query)
-    {
-        grammar_neighborhood(gi->gr, CGRAPH_EXACT_QUERY, rank, nodes, &nb);
-    }
-    else
-    {
-        grammar_neighborhood(gi->gr, CGRAPH_CONTAINS_QUERY, rank, nodes, &nb);
-    }
-
-	if(grammar_neighborhood_next(&nb, NULL)) {
-		grammar_neighborhood_finish(&nb);
+	EdgeIteratorImpl it;
+	cgraphr_neighborhood(gi, NULL, exact_query ? CGRAPH_EXACT_QUERY : CGRAPH_CONTAINS_QUERY, rank, nodes, &it);
+
+	if(cgraphr_neighborhood_next(&it, NULL) == 1) {
+		grammar_neighborhood_finish(&it.nb);
 		return true;
 	}
 
@@ -151,37 +268,383 @@ bool cgraphr_edge_exists(CGraphR* g, CGraphRank rank, const CGraphNode* nodes, b
 CGraphEdgeIterator* cgraphr_edges(CGraphR* g, CGraphRank rank, const CGraphNode* nodes, bool exact_query, bool no_node_order) {
     GraphReaderImpl* gi = (GraphReaderImpl*) g;
 
-    for (int i=0; i < rank; i++)
-    {
-        if(nodes[i] != CGRAPH_NODES_ALL && (nodes[i] < 0 || nodes[i] >= gi->gr->node_count)) // node does not exist nor is wildcard.
-            return NULL;
-    }
-
+    if(!cgraphr_nodes_exist(gi, rank, nodes))
+        return NULL;
 
-    GrammarNeighborhood* nb = malloc(sizeof(*nb));
-    if(!nb)
+    EdgeIteratorImpl* it = malloc(sizeof(*it));
+    if(!it)
         return NULL;
 
-    if (exact_query)
-    {
-        grammar_neighborhood(gi->gr, CGRAPH_EXACT_QUERY, rank, nodes, nb);
-    }
-    else
-    {
-        grammar_neighborhood(gi->gr, CGRAPH_CONTAINS_QUERY, rank, nodes, nb);
-    }
+    cgraphr_neighborhood(gi, NULL, exact_query ? CGRAPH_EXACT_QUERY : CGRAPH_CONTAINS_QUERY, rank, nodes, it);
 
-    return (CGraphEdgeIterator*) nb;
+    return (CGraphEdgeIterator*) it;
 }
 
 CGraphEdgeIterator* cgraphr_edges_all(CGraphR* g) {
     GraphReaderImpl* gi = (GraphReaderImpl*) g;
 
-    GrammarNeighborhood* nb = malloc(sizeof(*nb));
-    if(!nb)
+    EdgeIteratorImpl* it = malloc(sizeof(*it));
+    if(!it)
         return NULL;
 
-    grammar_neighborhood(gi->gr, CGRAPH_DECOMPRESS_QUERY, CGRAPH_LABELS_ALL, NULL, nb);
+    cgraphr_neighborhood(gi, NULL, CGRAPH_DECOMPRESS_QUERY, CGRAPH_LABELS_ALL, NULL, it);
+
+    return (CGraphEdgeIterator*) it;
+}
+
+// Queries at the same node are split into groups of this size, so the threads get a similar amount of work.
+#define BATCH_GROUP_SIZE 256
+
+typedef struct {
+	CGraphNode node; // first node of the query, CGRAPH_NODES_ALL if the query has no node
+	size_t query;
+} BatchQuery;
+
+typedef struct {
+	GraphReaderImpl* g;
+	const CGraphQuery* queries;
+	int query_type;
+	CGraphEdgeCallback cb;
+	void* ctx;
+
+	BatchQuery* order; // queries sorted by their first node
+	size_t* groups; // start of each group in `order` followed by the number of queries
+	size_t group_count;
+
+	size_t next_group; // next group to process, shared by the threads
+	int res;
+} BatchState;
+
+static int cmp_batch_query(const void* v1, const void* v2) {
+	const BatchQuery* q1 = v1;
+	const BatchQuery* q2 = v2;
+
+	if(q1->node != q2->node)
+		return CMP(q1->node, q2->node);
+	return CMP(q1->query, q2->query);
+}
+
+static int cgraphr_batch_query(BatchState* s, size_t q, const StartSymbolRow* row, CGraphEdge* e) {
+	const CGraphQuery* query = &s->queries[q];
+	if(!cgraphr_nodes_exist(s->g, query->rank, query->nodes))
+		return 0; // no edges like `cgraphr_edges`
+
+	EdgeIteratorImpl it;
+	cgraphr_neighborhood(s->g, row, s->query_type, query->rank, query->nodes, &it);
+
+	int res;
+	while((res = cgraphr_neighborhood_next(&it, e)) == 1) {
+		int r = s->cb(q, e, s->ctx);
+		if(r != 0) {
+			res = r < 0 ? -1 : 0;
+			break;
+		}
+	}
+
+	grammar_neighborhood_finish(&it.nb);
+	return res;
+}
+
+static int cgraphr_batch_group(BatchState* s, size_t group, CGraphEdge* e) {
+	GraphReaderImpl* gi = s->g;
+	size_t from = s->groups[group];
+	size_t to = s->groups[group + 1];
+	CGraphNode node = s->order[from].node;
+
+	// The edges at the node are only decoded once, if several queries share them.
+	StartSymbolRow row;
+	bool with_row = to - from > 1 && node != CGRAPH_NODES_ALL && node >= 0 && node < gi->gr->node_count;
+	if(with_row && startsymbol_row(gi->gr->start, node, &row) < 0)
+		return -1;
+
+	int res = 0;
+	for(size_t i = from; res == 0 && i < to; i++)
+		res = cgraphr_batch_query(s, s->order[i].query, with_row ? &row : NULL, e);
+
+	if(with_row)
+		startsymbol_row_destroy(&row);
+	return res;
+}
+
+static void* cgraphr_batch_worker(void* arg) {
+	BatchState* s = arg;
+
+	CGraphEdge e; // the nodes are set by the iterators of the queries
+	while(__atomic_load_n(&s->res, __ATOMIC_RELAXED) == 0) {
+		size_t group = __atomic_fetch_add(&s->next_group, 1, __ATOMIC_RELAXED);
+		if(group >= s->group_count)
+			break;
+
+		if(cgraphr_batch_group(s, group, &e) < 0)
+			__atomic_store_n(&s->res, -1, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+// Sorts the queries by their first node and splits them into groups.
+static int cgraphr_batch_groups(BatchState* s, size_t count) {
+	s->order = malloc(MAX(count, 1) * sizeof(*s->order));
+	s->groups = malloc((count + 1) * sizeof(*s->groups));
+	if(!s->order || !s->groups)
+		return -1;
+
+	for(size_t i = 0; i < count; i++) {
+		const CGraphQuery* q = &s->queries[i];
+
+		CGraphNode node = CGRAPH_NODES_ALL;
+		for(int j = 0; node == CGRAPH_NODES_ALL && q->nodes && j < q->rank; j++)
+			node = q->nodes[j];
+
+		s->order[i].node = node;
+		s->order[i].query = i;
+	}
+	qsort(s->order, count, sizeof(*s->order), cmp_batch_query);
+
+	s->group_count = 0;
+	for(size_t i = 0; i < count; i++) {
+		size_t start = s->group_count > 0 ? s->groups[s->group_count - 1] : 0;
+		if(i == 0 || s->order[i].node != s->order[i - 1].node || i - start == BATCH_GROUP_SIZE)
+			s->groups[s->group_count++] = i;
+	}
+	s->groups[s->group_count] = count;
+
+	return 0;
+}
+
+int cgraphr_edges_batch(CGraphR* g, size_t count, const CGraphQuery* queries, bool exact_query, int threads, CGraphEdgeCallback cb, void* ctx) {
+	BatchState s;
+	s.g = (GraphReaderImpl*) g;
+	s.queries = queries;
+	s.query_type = exact_query ? CGRAPH_EXACT_QUERY : CGRAPH_CONTAINS_QUERY;
+	s.cb = cb;
+	s.ctx = ctx;
+	s.next_group = 0;
+	s.res = 0;
+
+	if(cgraphr_batch_groups(&s, count) < 0) {
+		s.res = -1;
+		goto exit_0;
+	}
+
+	if(threads > 1 && (size_t) threads > s.group_count)
+		threads = s.group_count;
+
+	// The calling thread processes groups as well.
+	pthread_t* ids = threads > 1 ? malloc((threads - 1) * sizeof(*ids)) : NULL;
+	int started = 0;
+	if(ids) {
+		for(; started < threads - 1; started++) {
+			if(pthread_create(&ids[started], NULL, cgraphr_batch_worker, &s) != 0)
+				break;
+		}
+	}
+
+	cgraphr_batch_worker(&s);
+
+	for(int i = 0; i < started; i++)
+		pthread_join(ids[i], NULL);
+	if(ids)
+		free(ids);
+
+exit_0:
+	free(s.order);
+	free(s.groups);
+	return s.res;
+}
+
+int cgraphr_add_edge(CGraphR* g, CGraphRank rank, CGraphEdgeLabel label, const CGraphNode* nodes) {
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+	return delta_add(&gi->delta, label, rank, nodes);
+}
+
+// Searches the edge in the start symbol and returns its id, -1 if the edge is not an edge of the start symbol.
+static int64_t cgraphr_find_start_edge(GraphReaderImpl* gi, CGraphRank rank, CGraphEdgeLabel label, const CGraphNode* nodes) {
+	StartSymbolNeighborhood n;
+	startsymbol_neighborhood(gi->gr->start, CGRAPH_EXACT_QUERY, rank, nodes, &n);
+
+	int64_t id = -1;
+	StEdge e;
+	edge_init(&e);
+	while(id < 0 && startsymbol_neighborhood_next(&n, &e) == 1) {
+		if(e.label != (uint64_t) label || e.rank != rank)
+			continue;
+		if(memcmp(e.nodes, nodes, rank * sizeof(uint64_t)) != 0)
+			continue;
+		if(delta_start_edge_removed(&gi->delta, n.edge_id))
+			continue;
+		id = n.edge_id;
+	}
+
+	edge_destroy(&e);
+	startsymbol_neighborhood_finish(&n);
+	return id;
+}
+
+int cgraphr_remove_edge(CGraphR* g, CGraphRank rank, CGraphEdgeLabel label, const CGraphNode* nodes) {
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+
+	if(rank <= 0 || !cgraphr_nodes_exist(gi, rank, nodes))
+		return -1;
+	for(int i = 0; i < rank; i++)
+		if(nodes[i] == CGRAPH_NODES_ALL)
+			return -1;
+
+	// Edges contained in a running compaction cannot be removed anymore.
+	uint64_t min_gen = gi->compact.running ? gi->compact.gen : 0;
+	if(delta_remove(&gi->delta, label, rank, nodes, min_gen))
+		return 0;
+
+	if(gi->compact.running || !cgraphr_nodes_in_grammar(gi, rank, nodes))
+		return -1;
+
+	int64_t id = cgraphr_find_start_edge(gi, rank, label, nodes);
+	if(id < 0)
+		return -1;
+
+	return delta_remove_start_edge(&gi->delta, id);
+}
+
+static void* compact_thread(void* arg) {
+	CompactJob* job = arg;
+	job->res = -1;
+
+	CGraphW* w = cgraphw_init();
+	if(!w)
+		return NULL;
+
+	if(!job->default_params)
+		cgraphw_set_params(w, &job->params);
+
+	if(cgraphw_load_filtered(w, job->src, job->removed, job->removed_len) < 0)
+		goto exit_0;
+	if(job->count > 0 && cgraphw_add_edges(w, job->count, job->ranks, job->labels, job->nodes, 0) < 0)
+		goto exit_0;
+	if(cgraphw_compress(w) < 0)
+		goto exit_0;
+	if(cgraphw_write(w, job->dst, false) < 0)
+		goto exit_0;
+
+	job->res = 0;
+
+exit_0:
+	cgraphw_destroy(w);
+	return NULL;
+}
+
+static int cmp_uint64(const void* v1, const void* v2) {
+	uint64_t a = *(const uint64_t*) v1;
+	uint64_t b = *(const uint64_t*) v2;
+	return CMP(a, b);
+}
+
+// Copies the current delta to the job, the delta is not changed.
+static int compact_job_snapshot(CompactJob* job, const Delta* d) {
+	size_t m = 0;
+	for(size_t i = 0; i < d->len; i++)
+		m += d->edges[i]->rank;
+
+	job->count = d->len;
+	job->ranks = malloc(MAX(d->len, 1) * sizeof(*job->ranks));
+	job->labels = malloc(MAX(d->len, 1) * sizeof(*job->labels));
+	job->nodes = malloc(MAX(m, 1) * sizeof(*job->nodes));
+	job->removed_len = d->removed.len;
+	job->removed = malloc(MAX(d->removed.len, 1) * sizeof(*job->removed));
+	if(!job->ranks || !job->labels || !job->nodes || !job->removed)
+		return -1;
+
+	CGraphNode* nodes = job->nodes;
+	for(size_t i = 0; i < d->len; i++) {
+		const DeltaEdge* e = d->edges[i];
+		job->ranks[i] = e->rank;
+		job->labels[i] = e->label;
+		for(int j = 0; j < e->rank; j++)
+			*nodes++ = e->nodes[j];
+	}
+
+	size_t pos = 0, k = 0;
+	DeltaIdSetEntry* entry;
+	while((entry = delta_id_set_next(&d->removed, &pos)))
+		job->removed[k++] = entry->key;
+	qsort(job->removed, job->removed_len, sizeof(*job->removed), cmp_uint64);
+
+	return 0;
+}
+
+int cgraphr_compact(CGraphR* g, const char* path, const CGraphCParams* params) {
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+
+	// the file of the graph is still read while the new file is written
+	if(gi->compact.running || strcmp(path, gi->path) == 0)
+		return -1;
+
+	CompactJob* job = calloc(1, sizeof(*job));
+	if(!job)
+		return -1;
+
+	job->src = strdup(gi->path);
+	job->dst = strdup(path);
+	if(params)
+		job->params = *params;
+	else
+		job->default_params = true;
+	if(!job->src || !job->dst || compact_job_snapshot(job, &gi->delta) < 0)
+		goto err_0;
+
+	if(pthread_create(&gi->compact.thread, NULL, compact_thread, job) != 0)
+		goto err_0;
+
+	// edges added from now on get a new generation, so they are kept after the compaction
+	if(gi->compact.job)
+		compact_job_destroy(gi->compact.job);
+	gi->compact.job = job;
+	gi->compact.running = true;
+	gi->compact.gen = ++gi->delta.gen;
+	return 0;
+
+err_0:
+	compact_job_destroy(job);
+	return -1;
+}
+
+int cgraphr_compact_finish(CGraphR* g) {
+	GraphReaderImpl* gi = (GraphReaderImpl*) g;
+
+	if(!gi->compact.running)
+		return -1;
+
+	pthread_join(gi->compact.thread, NULL);
+	gi->compact.running = false;
+
+	CompactJob* job = gi->compact.job;
+	gi->compact.job = NULL;
+
+	int res = job->res;
+	if(res < 0)
+		goto exit_0;
+
+	// If the compacted graph cannot be opened, the delta is still valid for the old graph.
+	FileReader* fr;
+	GrammarReader* gr = cgraphr_open(job->dst, &fr);
+	if(!gr) {
+		res = -1;
+		goto exit_0;
+	}
+
+	grammar_destroy(gi->gr);
+	filereader_close(gi->r);
+	free(gi->path);
+
+	gi->r = fr;
+	gi->gr = gr;
+	gi->path = job->dst;
+	job->dst = NULL;
+
+	// the edges of the snapshot and the removed edges are contained in the compacted graph
+	delta_remove_before(&gi->delta, gi->compact.gen);
+	delta_id_set_clear(&gi->delta.removed);
 
-    return (CGraphEdgeIterator*) nb;
+exit_0:
+	compact_job_destroy(job);
+	return res;
 }
@@ -6,9 +6,17 @@
 #include <cgraph.h>
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include <hgraph.h>
 #include <treemap.h>
@@ -21,6 +29,10 @@
 #include <bitsequence.h>
 #include <writer.h>
 #include <slhr_grammar_writer.h>
+#include <reader.h>
+#include <grammar.h>
+
+#include "cgraphw_internal.h"
 
 typedef struct {
 	bool compressed;
@@ -34,6 +46,14 @@ typedef struct {
 		struct {
 			//Hashset* edges; // The edges are stored in a set because duplicate edges are not allowed
             HGraph* edges;
+			HEdgeArena* arena; // memory of the edges
+
+			// Only set if a compressed graph was loaded with `cgraphw_load`,
+			// the edges of its rules and its start symbol are allocated in `arena`.
+			HGraph* base_start;
+			HGraph** base_rules;
+			size_t base_rule_count;
+			uint64_t base_first_nt;
 		};
 		// Only needed after compression:
 		struct {
@@ -57,12 +77,6 @@ static Hash hash_size_cb(const void* k, size_t l) {
 	return HASH(*s);
 }
 
-static int cmp_edge_sort(const void* v1, const void* v2) {
-	const HEdge** e1 = (const HEdge**) v1;
-	const HEdge** e2 = (const HEdge**) v2;
-	return hedge_cmp(*e1, *e2);
-}
-
 static int cmp_edge_cb(const void* k1, size_t l1, const void* k2, size_t l2) {
 	const HEdge* e1 = k1;
 	const HEdge* e2 = k2;
@@ -92,13 +106,17 @@ CGraphW* cgraphw_init() {
 	if(!dict_rev)
 		goto err_0;
 
-	HGraph * edges = hgraph_init(RANK_NONE);
-	if(!edges)
+	HEdgeArena* arena = hedge_arena_init();
+	if(!arena)
 		goto err_1;
 
+	HGraph * edges = hgraph_init(RANK_NONE, arena);
+	if(!edges)
+		goto err_2;
+
 	GraphWriterImpl* g = malloc(sizeof(*g));
 	if(!g)
-		goto err_2;
+		goto err_3;
 
 	// Only init attributes needed before compression
 	g->compressed = false;
@@ -107,6 +125,10 @@ CGraphW* cgraphw_init() {
 	g->params.monograms = DEFAULT_MONOGRAMS;
 	g->params.factor = DEFAULT_FACTOR;
 	g->params.nt_table = DEFAULT_NT_TABLE;
+	g->params.threads = DEFAULT_THREADS;
+	g->params.max_memory = DEFAULT_MAX_MEMORY;
+	g->params.partitions = DEFAULT_PARTITIONS;
+	g->params.batch = DEFAULT_BATCH;
 #ifdef RRR
 	g->params.rrr = DEFAULT_RRR;
 #endif
@@ -114,11 +136,19 @@ CGraphW* cgraphw_init() {
 	g->terminals = 0;
 
 	g->edges = edges;
+	g->arena = arena;
+
+	g->base_start = NULL;
+	g->base_rules = NULL;
+	g->base_rule_count = 0;
+	g->base_first_nt = 0;
 
 	return (CGraphW*) g;
 
+err_3:
+	hgraph_destroy_without_edges(edges);
 err_2:
-	hgraph_destroy(edges);
+	hedge_arena_destroy(arena);
 err_1:
 	hashmap_destroy(dict_rev);
 err_0:
@@ -126,11 +156,33 @@ err_0:
 	return NULL;
 }
 
+// Frees the rules and the start symbol of the loaded graph, which are left in the writer.
+// Their edges are returned to the arena.
+static void cgraphw_base_destroy(GraphWriterImpl* gi) {
+	if(!gi->base_start)
+		return;
+
+	for(size_t i = 0; i < gi->base_rule_count; i++)
+		if(gi->base_rules[i])
+			hgraph_destroy(gi->base_rules[i]);
+	if(gi->base_rules)
+		free(gi->base_rules);
+	hgraph_destroy(gi->base_start);
+
+	gi->base_start = NULL;
+	gi->base_rules = NULL;
+	gi->base_rule_count = 0;
+}
+
 void cgraphw_destroy(CGraphW* g) {
 	GraphWriterImpl* gi = (GraphWriterImpl*) g;
 
 	if(!gi->compressed) {
-		hgraph_destroy(gi->edges);
+		if(gi->edges) {
+			cgraphw_base_destroy(gi);
+			hgraph_destroy_without_edges(gi->edges);
+			hedge_arena_destroy(gi->arena);
+		}
 	}
 	else {
 
@@ -150,16 +202,12 @@ int cgraphw_add_edge(CGraphW* g, const CGraphRank rank, CGraphRank label, const
     GraphWriterImpl* gi = (GraphWriterImpl*) g;
 
     // cannot add new edges if the graph is compressed
-    if(gi->compressed)
+    if(gi->compressed || !gi->edges)
         return -1;
 
-    // The memory of the edge is allocated via `alloca` because `hashmap` copies the data internally
-    // and then manages the memory itself.
-    // Furthermore, a short call to `alloca` is more efficient than `malloc` + `free`.
-    HEdge* edge = malloc(hedge_sizeof(rank));
+    HEdge* edge = hedge_arena_alloc(gi->arena, rank);
     if(!edge)
         return -1;
-    edge->rank = rank;
 
     edge->label = (CGraphEdgeLabel) label;
     gi->terminals = gi->terminals > edge->label + 1 ? gi->terminals : edge->label + 1;
@@ -172,12 +220,374 @@ int cgraphw_add_edge(CGraphW* g, const CGraphRank rank, CGraphRank label, const
     }
     gi->nodes = max_node;
 
-    if(hgraph_add_edge(gi->edges, edge) < 0)
+    if(hgraph_add_edge(gi->edges, edge) < 0) {
+        hedge_arena_free(gi->arena, edge);
         return -1;
+    }
 
     return 0;
 }
 
+int cgraphw_add_edges(CGraphW* g, size_t count, const CGraphRank* ranks, const CGraphEdgeLabel* labels, const CGraphNode* nodes, size_t capacity_hint) {
+	GraphWriterImpl* gi = (GraphWriterImpl*) g;
+
+	// cannot add new edges if the graph is compressed
+	if(gi->compressed || !gi->edges)
+		return -1;
+
+	size_t len = hgraph_len(gi->edges);
+
+	size_t size = 0;
+	for(size_t i = 0; i < count; i++) {
+		if(ranks[i] < 0)
+			return -1;
+		size += hedge_sizeof(ranks[i]);
+	}
+
+	// reserve the memory of all edges at once
+	if(hgraph_reserve(gi->edges, MAX(len + count, capacity_hint)) < 0)
+		return -1;
+	if(hedge_arena_reserve(gi->arena, size) < 0)
+		return -1;
+
+	uint64_t terminals = gi->terminals;
+	uint64_t max_node = gi->nodes; // 1 higher than the highest node
+
+	const CGraphNode* n = nodes;
+	for(size_t i = 0; i < count; i++) {
+		size_t rank = ranks[i];
+
+		HEdge* edge = hedge_arena_alloc(gi->arena, rank);
+		if(!edge)
+			goto err_0;
+
+		edge->label = (uint64_t) labels[i];
+		if(edge->label + 1 > terminals)
+			terminals = edge->label + 1;
+
+		for(size_t j = 0; j < rank; j++) {
+			edge->nodes[j] = (uint64_t) n[j];
+			if(edge->nodes[j] + 1 > max_node)
+				max_node = edge->nodes[j] + 1;
+		}
+		n += rank;
+
+		// cannot fail because of the reserved capacity
+		hgraph_add_edge(gi->edges, edge);
+	}
+
+	gi->terminals = terminals;
+	gi->nodes = max_node;
+
+	return 0;
+
+err_0:
+	// remove the edges of this batch again
+	while(gi->edges->len > len)
+		hedge_arena_free(gi->arena, gi->edges->edges[--gi->edges->len]);
+	return -1;
+}
+
+#define EDGES_HEADER_LEN (MAGIC_EDGES_LEN + 2 * sizeof(uint64_t))
+
+// Adds the edges of a binary edge list which is loaded at `data`.
+static int cgraphw_add_edges_data(CGraphW* g, const uint8_t* data, size_t size) {
+	if(size < EDGES_HEADER_LEN || memcmp(data, MAGIC_EDGES, MAGIC_EDGES_LEN) != 0)
+		return -1;
+
+	const uint64_t* header = (const uint64_t*) (data + MAGIC_EDGES_LEN);
+	uint64_t n = le64toh(header[0]);
+	uint64_t m = le64toh(header[1]);
+
+	size_t values = (size - EDGES_HEADER_LEN) / sizeof(uint64_t);
+	if(n > values / 2 || m != values - 2 * n || (size - EDGES_HEADER_LEN) % sizeof(uint64_t) != 0)
+		return -1;
+
+	const int64_t* ranks = (const int64_t*) (header + 2);
+	const int64_t* labels = ranks + n;
+	const int64_t* nodes = labels + n;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	// the data already has the layout of `cgraphw_add_edges`
+	const CGraphRank* r = ranks;
+	const CGraphEdgeLabel* l = labels;
+	const CGraphNode* v = nodes;
+#else
+	int64_t* copy = malloc((2 * n + m) * sizeof(*copy));
+	if(!copy)
+		return -1;
+
+	for(size_t i = 0; i < 2 * n + m; i++)
+		copy[i] = le64toh(ranks[i]);
+
+	const CGraphRank* r = copy;
+	const CGraphEdgeLabel* l = copy + n;
+	const CGraphNode* v = copy + 2 * n;
+#endif
+
+	// the ranks must fit to the number of nodes, otherwise nodes behind the data would be read
+	int res = -1;
+	uint64_t sum = 0;
+	for(size_t i = 0; i < n; i++) {
+		if(r[i] < 0 || (uint64_t) r[i] > m - sum)
+			goto exit;
+		sum += r[i];
+	}
+
+	if(sum == m)
+		res = cgraphw_add_edges(g, n, r, l, v, 0);
+
+exit:
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	free(copy);
+#endif
+	return res;
+}
+
+int cgraphw_add_edges_file(CGraphW* g, const char* path) {
+	int res = -1;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) < 0)
+		goto exit_0;
+
+	size_t size = st.st_size;
+	if(size < EDGES_HEADER_LEN)
+		goto exit_0;
+
+#ifdef USE_MMAP
+	uint8_t* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		goto exit_0;
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	res = cgraphw_add_edges_data(g, data, size);
+
+	munmap(data, size);
+#else
+	uint8_t* data = malloc(size);
+	if(!data)
+		goto exit_0;
+
+	size_t read_len = 0;
+	while(read_len < size) {
+		ssize_t r = read(fd, data + read_len, size - read_len);
+		if(r <= 0)
+			break;
+		read_len += r;
+	}
+
+	if(read_len == size)
+		res = cgraphw_add_edges_data(g, data, size);
+
+	free(data);
+#endif
+
+exit_0:
+	close(fd);
+	return res;
+}
+
+// Opens the grammar of a compressed graph like `cgraphr_init`.
+static GrammarReader* cgraphw_open_grammar(const char* path, FileReader** fr) {
+	if(access(path, F_OK | R_OK) != 0)
+		return NULL;
+
+	*fr = filereader_init(path);
+	if(!*fr)
+		return NULL;
+
+	Reader r;
+	reader_initf(*fr, &r, 0);
+
+	const uint8_t* magic = reader_read(&r, MAGIC_GRAPH_LEN);
+	if(memcmp(magic, MAGIC_GRAPH, MAGIC_GRAPH_LEN) != 0)
+		goto err_0;
+
+	size_t nbytes;
+	reader_vbyte(&r, &nbytes); // length of the grammar
+
+	reader_initf(*fr, &r, MAGIC_GRAPH_LEN + nbytes);
+	GrammarReader* gr = grammar_init(&r);
+	if(!gr)
+		goto err_0;
+
+	return gr;
+
+err_0:
+	filereader_close(*fr);
+	return NULL;
+}
+
+// Adds a copy of the decoded edge to the graph and returns the highest node of the edge + 1.
+static int cgraphw_load_edge(HGraph* graph, const StEdge* e, uint64_t* max_node) {
+	HEdge* edge = hgraph_edge_alloc(graph, e->rank);
+	if(!edge)
+		return -1;
+
+	edge->label = e->label;
+	for(int i = 0; i < e->rank; i++) {
+		edge->nodes[i] = e->nodes[i];
+		if(edge->nodes[i] + 1 > *max_node)
+			*max_node = edge->nodes[i] + 1;
+	}
+
+	if(hgraph_add_edge(graph, edge) < 0) {
+		hedge_arena_free(graph->arena, edge);
+		return -1;
+	}
+
+	return 0;
+}
+
+typedef struct {
+	HGraph* graph;
+	uint64_t max_node;
+
+	uint64_t id; // id of the next edge of the start symbol
+	const uint64_t* removed;
+	size_t removed_len;
+} LoadEdgesState;
+
+static int cgraphw_load_start_edge(const StEdge* e, void* ctx) {
+	LoadEdgesState* state = ctx;
+
+	// the edges are given in the order of their ids, so the sorted removed ids are merged
+	uint64_t id = state->id++;
+	while(state->removed_len > 0 && *state->removed < id) {
+		state->removed++;
+		state->removed_len--;
+	}
+	if(state->removed_len > 0 && *state->removed == id)
+		return 0;
+
+	return cgraphw_load_edge(state->graph, e, &state->max_node);
+}
+
+int cgraphw_load(CGraphW* g, const char* path) {
+	return cgraphw_load_filtered(g, path, NULL, 0);
+}
+
+int cgraphw_load_filtered(CGraphW* g, const char* path, const uint64_t* removed, size_t removed_len) {
+	GraphWriterImpl* gi = (GraphWriterImpl*) g;
+
+	// only one graph can be loaded
+	if(gi->compressed || !gi->edges || gi->base_start)
+		return -1;
+
+	FileReader* fr;
+	GrammarReader* gr = cgraphw_open_grammar(path, &fr);
+	if(!gr)
+		return -1;
+
+	int res = -1;
+
+	StEdge e;
+	edge_init(&e);
+
+	uint64_t first_nt = gr->rules->first_nt;
+	size_t rule_count = gr->rules->rule_count;
+
+	gi->base_start = hgraph_init(RANK_NONE, gi->arena);
+	if(!gi->base_start)
+		goto exit_1;
+	gi->base_rules = rule_count > 0 ? calloc(rule_count, sizeof(*gi->base_rules)) : NULL;
+	if(rule_count > 0 && !gi->base_rules)
+		goto err_0;
+	gi->base_rule_count = rule_count;
+	gi->base_first_nt = first_nt;
+
+	LoadEdgesState state = {gi->base_start, 0, 0, removed, removed_len};
+	if(startsymbol_edges(gr->start, cgraphw_load_start_edge, &state) < 0)
+		goto err_0;
+
+	for(size_t i = 0; i < rule_count; i++) {
+		HGraph* rule = hgraph_init(0, gi->arena);
+		if(!rule)
+			goto err_0;
+		gi->base_rules[i] = rule;
+
+		// The nodes of the edges in a rule are the indices of the external nodes of the rule.
+		// All nodes of a rule are external, so the rank is the highest index + 1.
+		uint64_t rank = 0;
+
+		Reader cursor;
+		int len = rules_seek(gr->rules, first_nt + i, &cursor);
+		for(int j = 0; j < len; j++) {
+			if(edge_read(&cursor, &e) < 0 || cgraphw_load_edge(rule, &e, &rank) < 0)
+				goto err_0;
+		}
+
+		rule->rank = rank;
+	}
+
+	// new edges may only introduce terminals behind the terminals of the loaded graph
+	if(first_nt > gi->terminals)
+		gi->terminals = first_nt;
+	if(gr->node_count > gi->nodes)
+		gi->nodes = gr->node_count;
+	if(state.max_node > gi->nodes)
+		gi->nodes = state.max_node;
+
+	res = 0;
+
+err_0:
+	if(res < 0)
+		cgraphw_base_destroy(gi);
+exit_1:
+	edge_destroy(&e);
+	grammar_destroy(gr);
+	filereader_close(fr);
+	return res;
+}
+
+static inline bool write_u64(FILE* f, uint64_t v) {
+	v = htole64(v);
+	return fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+int cgraphw_write_edges(CGraphW* g, const char* path) {
+	GraphWriterImpl* gi = (GraphWriterImpl*) g;
+
+	// the edges of a loaded graph are not decompressed
+	if(gi->compressed || !gi->edges || gi->base_start)
+		return -1;
+
+	FILE* f = fopen(path, "wb");
+	if(!f)
+		return -1;
+
+	HGraph* edges = gi->edges;
+	size_t len = hgraph_len(edges);
+
+	uint64_t m = 0;
+	for(size_t i = 0; i < len; i++)
+		m += hgraph_edge_get(edges, i)->rank;
+
+	bool ok = fwrite(MAGIC_EDGES, MAGIC_EDGES_LEN, 1, f) == 1;
+	ok = ok && write_u64(f, len);
+	ok = ok && write_u64(f, m);
+
+	for(size_t i = 0; ok && i < len; i++)
+		ok = write_u64(f, hgraph_edge_get(edges, i)->rank);
+	for(size_t i = 0; ok && i < len; i++)
+		ok = write_u64(f, hgraph_edge_get(edges, i)->label);
+	for(size_t i = 0; ok && i < len; i++) {
+		HEdge* e = hgraph_edge_get(edges, i);
+		for(size_t j = 0; ok && j < e->rank; j++)
+			ok = write_u64(f, e->nodes[j]);
+	}
+
+	if(fclose(f) != 0)
+		ok = false;
+
+	return ok ? 0 : -1;
+}
+
 void cgraphw_set_params(CGraphW* g, const CGraphCParams* p) {
 	if(!p)
 		return;
@@ -192,79 +602,228 @@ void cgraphw_set_params(CGraphW* g, const CGraphCParams* p) {
 	if(p->factor > 0)
 		gi->params.factor = p->factor;
 	gi->params.nt_table = p->nt_table;
+	if(p->threads > 0)
+		gi->params.threads = p->threads;
+	gi->params.max_memory = p->max_memory;
+	if(p->partitions > 0)
+		gi->params.partitions = p->partitions;
+	if(p->batch > 0)
+		gi->params.batch = p->batch;
 #ifdef RRR
 	gi->params.rrr = p->rrr;
 #endif
+
+	// Half of the memory is left for the edges, the other half is used by RePair.
+	// The limit only applies to edges added afterwards, so the parameters should be set before adding edges.
+	if(!gi->compressed && gi->arena)
+		hedge_arena_set_limit(gi->arena, gi->params.max_memory / 2);
 }
 
-static HGraph* cgraphw_sort_edges(GraphWriterImpl* g) {
-	HGraph* gr = hgraph_init(RANK_NONE);
-	if(!gr)
-		goto err_1;
+// Ranges with fewer edges are sorted with insertion sort instead of radix sort
+#define SORT_INSERTION_THRESHOLD 32
+
+static void cgraphw_insertion_sort(HEdge** edges, size_t len) {
+	for(size_t i = 1; i < len; i++) {
+		HEdge* e = edges[i];
+		size_t j = i;
+		while(j > 0 && hedge_cmp(edges[j - 1], e) > 0) {
+			edges[j] = edges[j - 1];
+			j--;
+		}
+		edges[j] = e;
+	}
+}
 
-//	HashsetIterator it;
-//	hashset_iter(g->edges, &it);
-	const HEdge* edge;
-//	//while((edge = hashset_iter_next(&it, NULL)) != NULL) {
-    for (size_t i = 0; i < hgraph_len(g->edges); i++) {
-        edge = hgraph_edge_get(g->edges, i);
-		HEdge* e = malloc(hedge_sizeof(edge->rank));
-		if(!e)
-			goto err_2;
-
-        e->label = edge->label;
-
-        // determine the value in the edge label dict
-        e->rank = edge->rank;
-
-        for (size_t j = 0; j < edge->rank; j++) {
-            e->nodes[j] = edge->nodes[j]; // determine the value in the node label dict
-        }
-
-        if(hgraph_add_edge(gr, e) < 0) {
-            free(e);
-            goto err_2;
-        }
-    }
+// The key of an edge at level 0 is its label, at level i > 0 the (i - 1)-th node.
+#define edge_key(e, level) ((level) == 0 ? (e)->label : (e)->nodes[(level) - 1])
+
+static void cgraphw_radix_sort_level(HEdge** edges, size_t len, size_t level);
+
+// Sorts the edges, whose keys at `level` are equal above the byte at `shift`, with an in-place MSD radix sort.
+static void cgraphw_radix_sort_byte(HEdge** edges, size_t len, size_t level, int shift) {
+	if(len < SORT_INSERTION_THRESHOLD) {
+		cgraphw_insertion_sort(edges, len);
+		return;
+	}
+
+	size_t count[256] = {0};
+	for(size_t i = 0; i < len; i++)
+		count[(edge_key(edges[i], level) >> shift) & 0xff]++;
+
+	size_t start[256], end[256];
+	size_t pos = 0;
+	for(int b = 0; b < 256; b++) {
+		start[b] = pos;
+		pos += count[b];
+		end[b] = pos;
+	}
+
+	// Move each edge into its bucket by swapping (American flag sort)
+	for(int b = 0; b < 256; b++) {
+		while(start[b] < end[b]) {
+			HEdge* e = edges[start[b]];
+			int eb = (edge_key(e, level) >> shift) & 0xff;
+			if(eb == b)
+				start[b]++;
+			else {
+				edges[start[b]] = edges[start[eb]];
+				edges[start[eb]++] = e;
+			}
+		}
+	}
+
+	pos = 0;
+	for(int b = 0; b < 256; b++) {
+		if(count[b] > 1) {
+			if(shift > 0)
+				cgraphw_radix_sort_byte(edges + pos, count[b], level, shift - 8);
+			else
+				cgraphw_radix_sort_level(edges + pos, count[b], level + 1);
+		}
+		pos += count[b];
+	}
+}
+
+// Sorts the edges, which are equal on all keys before `level`, in the order of `hedge_cmp`.
+static void cgraphw_radix_sort_level(HEdge** edges, size_t len, size_t level) {
+	if(len < SORT_INSERTION_THRESHOLD) {
+		cgraphw_insertion_sort(edges, len);
+		return;
+	}
+
+	// Edges without a node at this level are shorter, so these are moved to the front.
+	size_t shorter = 0;
+	if(level > 0) {
+		for(size_t i = 0; i < len; i++) {
+			if(edges[i]->rank < level) {
+				HEdge* tmp = edges[shorter];
+				edges[shorter++] = edges[i];
+				edges[i] = tmp;
+			}
+		}
+	}
+	// The shorter edges are equal, so these are already sorted.
+	edges += shorter;
+	len -= shorter;
+	if(len < 2)
+		return;
+
+	// skip the bytes which are zero for all keys
+	uint64_t bits = 0;
+	for(size_t i = 0; i < len; i++)
+		bits |= edge_key(edges[i], level);
+
+	int shift = 0;
+	while(shift < 56 && (bits >> (shift + 8)) != 0)
+		shift += 8;
+
+	cgraphw_radix_sort_byte(edges, len, level, shift);
+}
 
+// The edges are sorted in place, so no copy of the graph is needed.
+static void cgraphw_sort_edges(GraphWriterImpl* g) {
 	// sorting the edges enhances the compression
-	qsort(gr->edges, gr->len, sizeof(HEdge*), cmp_edge_sort);
+	cgraphw_radix_sort_level(g->edges->edges, hgraph_len(g->edges), 0);
+}
 
-	return gr;
+// Renames the nonterminals of the edges by adding `shift` to them.
+static void cgraphw_shift_nts(HGraph* graph, uint64_t first_nt, uint64_t shift) {
+	for(size_t i = 0; i < hgraph_len(graph); i++) {
+		HEdge* edge = hgraph_edge_get(graph, i);
+		if(edge->label >= first_nt)
+			edge->label += shift;
+	}
+}
 
-err_2:
-	hgraph_destroy(gr);
-err_1:
-	return NULL;
+// Moves the edges of the start symbol of the loaded graph to the edges of the writer.
+// The nonterminals of the loaded graph are moved behind the terminals, because the added edges may
+// introduce new terminals, which would collide with them otherwise.
+static int cgraphw_merge_base(GraphWriterImpl* gi) {
+	HGraph* start = gi->base_start;
+	if(hgraph_reserve(gi->edges, hgraph_len(gi->edges) + hgraph_len(start)) < 0)
+		return -1;
+
+	uint64_t shift = gi->terminals - gi->base_first_nt;
+	if(shift > 0) {
+		cgraphw_shift_nts(start, gi->base_first_nt, shift);
+		for(size_t i = 0; i < gi->base_rule_count; i++)
+			cgraphw_shift_nts(gi->base_rules[i], gi->base_first_nt, shift);
+		gi->base_first_nt += shift;
+	}
+
+	// cannot fail because of the reserved capacity
+	for(size_t i = 0; i < hgraph_len(start); i++)
+		hgraph_add_edge(gi->edges, hgraph_edge_get(start, i));
+	start->len = 0;
+
+	return 0;
+}
+
+// Creates the grammar of the edges with the rules of the loaded graph and runs RePair on it.
+// On errors, the edges are destroyed like in `repair`.
+static SLHRGrammar* cgraphw_repair_base(GraphWriterImpl* gi) {
+	SLHRGrammar* gr = slhr_grammar_init(gi->edges, gi->terminals);
+	if(!gr) {
+		cgraphw_base_destroy(gi);
+		hgraph_destroy_without_edges(gi->edges);
+		hedge_arena_destroy(gi->arena);
+		return NULL;
+	}
+
+	int res = 0;
+	for(size_t i = 0; res == 0 && i < gi->base_rule_count; i++) {
+		HGraph* rule = gi->base_rules[i];
+
+		// the terminals of the rules may not occur in the start symbol
+		for(size_t j = 0; j < hgraph_len(rule); j++) {
+			HEdge* edge = hgraph_edge_get(rule, j);
+			if(edge->label < gi->terminals)
+				gr->rank_of_terminal[edge->label] = edge->rank;
+		}
+
+		if((res = slhr_grammar_rule_add(gr, gi->base_first_nt + i, rule)) == 0)
+			gi->base_rules[i] = NULL;
+	}
+
+	// the rules are owned by the grammar now
+	cgraphw_base_destroy(gi);
+
+	if(res == 0)
+		res = repair_append(gr, gi->nodes, gi->params.max_rank, gi->params.monograms, gi->params.threads, gi->params.max_memory, gi->params.batch);
+	if(res < 0) {
+		slhr_grammar_destroy(gr);
+		return NULL;
+	}
+
+	return gr;
 }
 
 int cgraphw_compress(CGraphW* g) {
 	GraphWriterImpl* gi = (GraphWriterImpl*) g;
 
-	if(gi->compressed)
+	if(gi->compressed || !gi->edges)
+		return -1;
+	if(gi->base_start && cgraphw_merge_base(gi) < 0)
 		return -1;
 	if(hgraph_len(gi->edges) == 0) // empty graph is not supported
 		return -1;
 
-	HGraph* start_symbol = cgraphw_sort_edges(gi);
-	if(!start_symbol)
-		goto err_0;
-
-	SLHRGrammar* gr = repair(start_symbol, gi->nodes, gi->terminals, gi->params.max_rank, gi->params.monograms);
-	if(!gr)
-		goto err_0;
-	// destroying `start_symbol` not needed because the memory is managed by `repair` or the grammar `gr`
+	cgraphw_sort_edges(gi);
 
-	// destroy the data if the repair-compression fully succeeded
-	hgraph_destroy(gi->edges);
+	// The edges and their arena are handed over to `repair` and are managed by the grammar afterwards.
+	// On errors, `repair` destroys them, so the writer has no edges anymore.
+	// The rules of a loaded graph are reused, so its edges are not partitioned.
+	SLHRGrammar* gr = gi->base_start ? cgraphw_repair_base(gi) : repair(gi->edges, gi->nodes, gi->terminals, gi->params.max_rank, gi->params.monograms, gi->params.threads, gi->params.max_memory, gi->params.partitions, gi->params.batch);
+	if(!gr) {
+		gi->edges = NULL;
+		gi->arena = NULL;
+		return -1;
+	}
 
 	gi->compressed = true;
 	gi->grammar = gr;
 
 	return 0;
-
-err_0:
-	return -1;
 }
 
 int cgraphw_write(CGraphW* g, const char* path, bool verbose) {
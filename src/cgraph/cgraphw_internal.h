@@ -0,0 +1,17 @@
+/**
+ * @file cgraphw_internal.h
+ * @author FR
+ */
+
+#ifndef CGRAPHW_INTERNAL_H
+#define CGRAPHW_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cgraph.h>
+
+// Like `cgraphw_load`, but the edges of the start symbol with the ids in `removed` are not loaded.
+// The ids must be sorted in ascending order.
+int cgraphw_load_filtered(CGraphW* g, const char* path, const uint64_t* removed, size_t removed_len);
+
+#endif
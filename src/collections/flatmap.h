@@ -0,0 +1,195 @@
+/**
+ * @file flatmap.h
+ * @author FR
+ */
+
+#ifndef FLATMAP_H
+#define FLATMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Typed hash maps with open addressing and linear probing.
+// In contrast to `Hashmap`, the keys and values are stored inline in one array of entries,
+// so no memory is allocated per entry and no function pointers are called.
+// Because the index of an entry is determined by the lowest bits of the hash value,
+// the hash functions should use `flatmap_mix64` to distribute the values.
+//
+// `FLATMAP_DEFINE(Map, prefix, K, V, hash_fn, eq_fn)` defines the types `Map` and `MapEntry`
+// and the following functions:
+//   void prefix_init(Map* m);
+//   void prefix_destroy(Map* m);
+//   void prefix_clear(Map* m);                         // removes all entries but keeps the memory
+//   size_t prefix_size(const Map* m);
+//   V* prefix_get(const Map* m, const K* key);         // NULL if the key does not exist
+//   V* prefix_put(Map* m, const K* key, bool* added);  // value of the key, a new value is set to zero; NULL on errors
+//   bool prefix_remove(Map* m, const K* key);
+//   MapEntry* prefix_next(const Map* m, size_t* pos);  // iterates over all entries, `pos` must be 0 at the beginning
+// with `uint64_t hash_fn(const K*)` and `bool eq_fn(const K*, const K*)`.
+// Pointers to values are only valid until the map is modified the next time.
+
+#define FLATMAP_DEFAULT_CAPACITY 16
+
+// Finalizer of MurmurHash3
+static inline uint64_t flatmap_mix64(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+#define FLATMAP_HASH_COMBINE(hash, value) do { \
+	(hash) = flatmap_mix64((hash) ^ (uint64_t) (value)); \
+} while(0)
+
+#define FLATMAP_DEFINE(Map, prefix, K, V, hash_fn, eq_fn) \
+\
+typedef struct { \
+	K key; \
+	V val; \
+} Map##Entry; \
+\
+typedef struct { \
+	size_t len; \
+	size_t cap; /* always a power of 2 */ \
+	uint8_t* used; /* 1 if the entry at the position is used */ \
+	Map##Entry* entries; \
+} Map; \
+\
+static inline void prefix##_init(Map* m) { \
+	m->len = 0; \
+	m->cap = 0; \
+	m->used = NULL; \
+	m->entries = NULL; \
+} \
+\
+static inline void prefix##_destroy(Map* m) { \
+	if(m->used) \
+		free(m->used); \
+	if(m->entries) \
+		free(m->entries); \
+} \
+\
+static inline void prefix##_clear(Map* m) { \
+	if(m->len > 0) \
+		memset(m->used, 0, m->cap); \
+	m->len = 0; \
+} \
+\
+static inline size_t prefix##_size(const Map* m) { \
+	return m->len; \
+} \
+\
+/* Returns the position of the key or of the free position where the key would be inserted. */ \
+static inline size_t prefix##_find(const Map* m, const K* key, bool* found) { \
+	size_t mask = m->cap - 1; \
+	size_t i = hash_fn(key) & mask; \
+	while(m->used[i]) { \
+		if(eq_fn(&m->entries[i].key, key)) { \
+			*found = true; \
+			return i; \
+		} \
+		i = (i + 1) & mask; \
+	} \
+	*found = false; \
+	return i; \
+} \
+\
+static inline V* prefix##_get(const Map* m, const K* key) { \
+	if(m->len == 0) \
+		return NULL; \
+	bool found; \
+	size_t i = prefix##_find(m, key, &found); \
+	return found ? &m->entries[i].val : NULL; \
+} \
+\
+static inline int prefix##_resize(Map* m, size_t cap) { \
+	uint8_t* used = calloc(cap, sizeof(*used)); \
+	if(!used) \
+		return -1; \
+	Map##Entry* entries = malloc(cap * sizeof(*entries)); \
+	if(!entries) { \
+		free(used); \
+		return -1; \
+	} \
+	\
+	Map tmp = {m->len, cap, used, entries}; \
+	for(size_t j = 0; j < m->cap; j++) { \
+		if(m->used[j]) { \
+			bool found; \
+			size_t i = prefix##_find(&tmp, &m->entries[j].key, &found); \
+			used[i] = 1; \
+			entries[i] = m->entries[j]; \
+		} \
+	} \
+	\
+	prefix##_destroy(m); \
+	*m = tmp; \
+	return 0; \
+} \
+\
+static inline V* prefix##_put(Map* m, const K* key, bool* added) { \
+	/* the load factor is at most 3/4 */ \
+	if((m->len + 1) * 4 > m->cap * 3) { \
+		if(prefix##_resize(m, m->cap == 0 ? FLATMAP_DEFAULT_CAPACITY : 2 * m->cap) < 0) \
+			return NULL; \
+	} \
+	\
+	bool found; \
+	size_t i = prefix##_find(m, key, &found); \
+	if(!found) { \
+		m->used[i] = 1; \
+		m->entries[i].key = *key; \
+		memset(&m->entries[i].val, 0, sizeof(V)); \
+		m->len++; \
+	} \
+	if(added) \
+		*added = !found; \
+	return &m->entries[i].val; \
+} \
+\
+static inline bool prefix##_remove(Map* m, const K* key) { \
+	if(m->len == 0) \
+		return false; \
+	\
+	bool found; \
+	size_t i = prefix##_find(m, key, &found); \
+	if(!found) \
+		return false; \
+	\
+	/* Move the following entries of the cluster backwards, if their preferred position */ \
+	/* is not between the free position and their position, so no tombstones are needed. */ \
+	size_t mask = m->cap - 1; \
+	size_t j = i; \
+	while(true) { \
+		j = (j + 1) & mask; \
+		if(!m->used[j]) \
+			break; \
+		size_t k = hash_fn(&m->entries[j].key) & mask; \
+		if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) \
+			continue; \
+		m->entries[i] = m->entries[j]; \
+		i = j; \
+	} \
+	m->used[i] = 0; \
+	m->len--; \
+	return true; \
+} \
+\
+static inline Map##Entry* prefix##_next(const Map* m, size_t* pos) { \
+	for(size_t i = *pos; i < m->cap; i++) { \
+		if(m->used[i]) { \
+			*pos = i + 1; \
+			return &m->entries[i]; \
+		} \
+	} \
+	*pos = m->cap; \
+	return NULL; \
+}
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file pqueue.c
+ * @author FR
+ */
+
+#include "pqueue.h"
+
+#include <stdlib.h>
+#include <assert.h>
+#include <arith.h>
+
+#define PQUEUE_DEFAULT_CAPACITY 16
+
+void pqueue_init(PQueue* q, pqueue_cmp_fn cmp, void* ctx) {
+	q->len = 0;
+	q->cap = 0;
+	q->heap = NULL;
+	q->pos_cap = 0;
+	q->pos = NULL;
+	q->cmp = cmp;
+	q->ctx = ctx;
+}
+
+void pqueue_destroy(PQueue* q) {
+	if(q->heap)
+		free(q->heap);
+	if(q->pos)
+		free(q->pos);
+}
+
+bool pqueue_contains(const PQueue* q, size_t id) {
+	return id < q->pos_cap && q->pos[id] != PQUEUE_NONE;
+}
+
+static inline void pqueue_set(PQueue* q, size_t i, size_t id) {
+	q->heap[i] = id;
+	q->pos[id] = i;
+}
+
+static void pqueue_sift_up(PQueue* q, size_t i) {
+	size_t id = q->heap[i];
+
+	while(i > 0) {
+		size_t parent = (i - 1) >> 1;
+		size_t pid = q->heap[parent];
+
+		if(q->cmp(id, pid, q->ctx) >= 0)
+			break;
+
+		pqueue_set(q, i, pid);
+		i = parent;
+	}
+
+	pqueue_set(q, i, id);
+}
+
+static void pqueue_sift_down(PQueue* q, size_t i) {
+	size_t id = q->heap[i];
+	size_t half = q->len >> 1;
+
+	while(i < half) {
+		size_t child = 2 * i + 1;
+		size_t right = child + 1;
+
+		if(right < q->len && q->cmp(q->heap[right], q->heap[child], q->ctx) < 0)
+			child = right;
+		if(q->cmp(id, q->heap[child], q->ctx) <= 0)
+			break;
+
+		pqueue_set(q, i, q->heap[child]);
+		i = child;
+	}
+
+	pqueue_set(q, i, id);
+}
+
+static int pqueue_ensure_pos(PQueue* q, size_t id) {
+	if(id < q->pos_cap)
+		return 0;
+
+	size_t new_cap = NEW_LEN(q->pos_cap, id + 1 - q->pos_cap, MAX(q->pos_cap >> 1, PQUEUE_DEFAULT_CAPACITY));
+	size_t* tmp = realloc(q->pos, new_cap * sizeof(*tmp));
+	if(!tmp)
+		return -1;
+
+	for(size_t i = q->pos_cap; i < new_cap; i++)
+		tmp[i] = PQUEUE_NONE;
+
+	q->pos_cap = new_cap;
+	q->pos = tmp;
+	return 0;
+}
+
+int pqueue_push(PQueue* q, size_t id) {
+	assert(!pqueue_contains(q, id));
+
+	if(pqueue_ensure_pos(q, id) < 0)
+		return -1;
+
+	if(q->len == q->cap) {
+		size_t new_cap = NEW_LEN(q->cap, 1, MAX(q->cap >> 1, PQUEUE_DEFAULT_CAPACITY));
+		size_t* tmp = realloc(q->heap, new_cap * sizeof(*tmp));
+		if(!tmp)
+			return -1;
+
+		q->cap = new_cap;
+		q->heap = tmp;
+	}
+
+	size_t i = q->len++;
+	pqueue_set(q, i, id);
+	pqueue_sift_up(q, i);
+	return 0;
+}
+
+void pqueue_update(PQueue* q, size_t id) {
+	assert(pqueue_contains(q, id));
+
+	size_t i = q->pos[id];
+	pqueue_sift_up(q, i);
+	if(q->pos[id] == i) // element did not move up, so it may has to move down
+		pqueue_sift_down(q, i);
+}
+
+void pqueue_remove(PQueue* q, size_t id) {
+	if(!pqueue_contains(q, id))
+		return;
+
+	size_t i = q->pos[id];
+	q->pos[id] = PQUEUE_NONE;
+
+	size_t last = --q->len;
+	if(i == last)
+		return;
+
+	// move the last element to the free position and restore the heap property
+	pqueue_set(q, i, q->heap[last]);
+	pqueue_update(q, q->heap[i]);
+}
+
+size_t pqueue_peek(const PQueue* q) {
+	assert(q->len > 0);
+
+	return q->heap[0];
+}
+
+size_t pqueue_pop(PQueue* q) {
+	size_t id = pqueue_peek(q);
+	pqueue_remove(q, id);
+	return id;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file pqueue.h
+ * @author FR
+ */
+
+#ifndef PQUEUE_H
+#define PQUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Value used as position of ids that are not in the queue.
+#define PQUEUE_NONE ((size_t) -1)
+
+// Compares the elements with the ids `a` and `b`.
+// The element with the lowest value is at the head of the queue.
+typedef int (*pqueue_cmp_fn) (size_t a, size_t b, void* ctx);
+
+// Indexed binary heap of element ids.
+// The queue does not store the priorities itself, these are determined by the comparator.
+// Because the position of every id is tracked, the priority of an element can be changed
+// at any time with `pqueue_update` in O(log n).
+typedef struct {
+	size_t len;
+	size_t cap;
+	size_t* heap; // ids of the elements
+
+	size_t pos_cap;
+	size_t* pos; // position of an id in the heap, PQUEUE_NONE if the id is not in the queue
+
+	pqueue_cmp_fn cmp;
+	void* ctx;
+} PQueue;
+
+void pqueue_init(PQueue* q, pqueue_cmp_fn cmp, void* ctx);
+void pqueue_destroy(PQueue* q);
+
+#define pqueue_size(q) ((q)->len)
+#define pqueue_empty(q) ((q)->len == 0)
+
+bool pqueue_contains(const PQueue* q, size_t id);
+
+// the id must not exist in the queue
+int pqueue_push(PQueue* q, size_t id);
+
+// the id must exist in the queue, must be called after the priority of the element has changed
+void pqueue_update(PQueue* q, size_t id);
+
+// does nothing if the id does not exist in the queue
+void pqueue_remove(PQueue* q, size_t id);
+
+// the queue must not be empty
+size_t pqueue_peek(const PQueue* q);
+size_t pqueue_pop(PQueue* q);
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * @file hedge_arena.c
+ * @author FR
+ */
+
+#include "hedge_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <hgraph.h>
+#include <arith.h>
+
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#endif
+
+#define HEDGE_ARENA_SLAB_SIZE (1 << 20) // size of a slab in bytes
+
+// The next pointer of a released edge is stored in its label,
+// because the rank must be kept to know the size of the released edge.
+#define hedge_arena_next(e) (*((HEdge**) &(e)->label))
+
+HEdgeArena* hedge_arena_init() {
+	HEdgeArena* a = malloc(sizeof(*a));
+	if(!a)
+		return NULL;
+
+	a->slabs = NULL;
+	memset(a->free, 0, sizeof(a->free));
+	a->max_free = 0;
+	a->free_size = 0;
+	a->released = 0;
+	a->limit = 0;
+	a->mem_size = 0;
+	a->file = NULL;
+	a->file_size = 0;
+	return a;
+}
+
+void hedge_arena_destroy(HEdgeArena* a) {
+	HEdgeSlab* s = a->slabs;
+	while(s) {
+		HEdgeSlab* next = s->next;
+#ifdef USE_MMAP
+		if(s->mapped > 0)
+			munmap(s, s->mapped);
+		else
+#endif
+			free(s);
+		s = next;
+	}
+
+	if(a->file)
+		fclose(a->file); // the temporary file is deleted automatically
+	free(a);
+}
+
+void hedge_arena_set_limit(HEdgeArena* a, size_t limit) {
+	a->limit = limit;
+}
+
+void hedge_arena_release(HEdgeArena* a) {
+#ifdef USE_MMAP
+	// The mapping is shared with the file, so the pages are only removed from the process
+	// and the kernel writes modified pages back to the file.
+	for(HEdgeSlab* s = a->slabs; s; s = s->next)
+		if(s->mapped > 0)
+			madvise(s, s->mapped, MADV_DONTNEED);
+#else
+	(void) a;
+#endif
+}
+
+#ifdef USE_MMAP
+// Maps a new slab with at least `size` bytes from the end of the temporary file.
+static HEdgeSlab* hedge_arena_map_slab(HEdgeArena* a, size_t size) {
+	size_t page = sysconf(_SC_PAGESIZE);
+	size = (size + page - 1) / page * page; // the offsets in the file must be aligned to pages
+
+	if(!a->file && !(a->file = tmpfile()))
+		return NULL;
+
+	int fd = fileno(a->file);
+	if(ftruncate(fd, a->file_size + size) < 0)
+		return NULL;
+
+	HEdgeSlab* s = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, a->file_size);
+	if(s == MAP_FAILED)
+		return NULL;
+
+	a->file_size += size;
+	s->mapped = size;
+	return s;
+}
+#endif
+
+// If `current` is false, a large slab is inserted after the current one,
+// so the free space of the current slab is not wasted.
+static HEdgeSlab* hedge_arena_add_slab(HEdgeArena* a, size_t min_size, bool current) {
+	size_t cap = MAX(min_size, HEDGE_ARENA_SLAB_SIZE - sizeof(HEdgeSlab));
+
+	HEdgeSlab* s;
+#ifdef USE_MMAP
+	if(a->limit > 0 && a->mem_size + sizeof(*s) + cap > a->limit) {
+		if(!(s = hedge_arena_map_slab(a, sizeof(*s) + cap)))
+			return NULL;
+		cap = s->mapped - sizeof(*s);
+	}
+	else
+#endif
+	{
+		if(!(s = malloc(sizeof(*s) + cap)))
+			return NULL;
+		s->mapped = 0;
+		a->mem_size += sizeof(*s) + cap;
+	}
+
+	s->len = 0;
+	s->cap = cap;
+
+	if(!current && a->slabs && cap > HEDGE_ARENA_SLAB_SIZE - sizeof(HEdgeSlab)) {
+		s->next = a->slabs->next;
+		a->slabs->next = s;
+	}
+	else {
+		s->next = a->slabs;
+		a->slabs = s;
+	}
+	return s;
+}
+
+int hedge_arena_reserve(HEdgeArena* a, size_t size) {
+	if(a->slabs && a->slabs->cap - a->slabs->len >= size)
+		return 0;
+
+	return hedge_arena_add_slab(a, size, true) ? 0 : -1;
+}
+
+static inline size_t hedge_arena_class(size_t rank) {
+	if(rank < HEDGE_ARENA_EXACT_RANKS)
+		return rank;
+	return HEDGE_ARENA_EXACT_RANKS + BIT_LEN(rank) - BIT_LEN(HEDGE_ARENA_EXACT_RANKS);
+}
+
+static inline void hedge_arena_push(HEdgeArena* a, HEdge* e) {
+	size_t c = hedge_arena_class(e->rank);
+	hedge_arena_next(e) = a->free[c];
+	a->free[c] = e;
+	if(c > a->max_free)
+		a->max_free = c;
+	a->free_size += hedge_sizeof(e->rank);
+}
+
+// The rest of a split edge must be large enough for an edge of rank 0,
+// so the rank of the released edge must be the same or at least 2 higher.
+#define hedge_arena_fits(e, r) ((e)->rank == (r) || (e)->rank >= (r) + 2)
+
+// Takes a released edge of the given rank, a larger one is split and its rest is released again.
+// The first fitting edge of the lowest possible class is taken, so large edges are kept for large ranks.
+static HEdge* hedge_arena_take(HEdgeArena* a, size_t rank) {
+	for(size_t c = hedge_arena_class(rank); c <= a->max_free; c++) {
+		// all edges of a class below `HEDGE_ARENA_EXACT_RANKS` have the same rank
+		HEdge** prev = &a->free[c];
+		if(c < HEDGE_ARENA_EXACT_RANKS && *prev && !hedge_arena_fits(*prev, rank))
+			continue;
+		while(*prev && !hedge_arena_fits(*prev, rank))
+			prev = &hedge_arena_next(*prev);
+
+		HEdge* e = *prev;
+		if(!e)
+			continue;
+
+		*prev = hedge_arena_next(e);
+		a->free_size -= hedge_sizeof(e->rank);
+		while(a->max_free > 0 && !a->free[a->max_free])
+			a->max_free--;
+
+		if(e->rank > rank) {
+			HEdge* rest = (HEdge*) ((uint8_t*) e + hedge_sizeof(rank));
+			rest->rank = e->rank - rank - 2; // hedge_sizeof(e->rank) - hedge_sizeof(rank) == hedge_sizeof(e->rank - rank - 2)
+			hedge_arena_push(a, rest);
+			e->rank = rank;
+		}
+		return e;
+	}
+
+	return NULL;
+}
+
+static int hedge_arena_cmp(const void* e1, const void* e2) {
+	uintptr_t a = (uintptr_t) *((HEdge* const*) e1);
+	uintptr_t b = (uintptr_t) *((HEdge* const*) e2);
+	return CMP(a, b);
+}
+
+// Merges the released edges that are adjacent in memory into one larger released edge.
+// Adjacent edges are always in the same slab, because the header of a slab is before its edges.
+static void hedge_arena_coalesce(HEdgeArena* a) {
+	size_t len = 0;
+	for(size_t c = 0; c <= a->max_free; c++)
+		for(HEdge* e = a->free[c]; e; e = hedge_arena_next(e))
+			len++;
+
+	HEdge** edges = malloc(len * sizeof(*edges));
+	if(!edges)
+		return; // the released edges are only not merged
+
+	len = 0;
+	for(size_t c = 0; c <= a->max_free; c++) {
+		for(HEdge* e = a->free[c]; e; e = hedge_arena_next(e))
+			edges[len++] = e;
+		a->free[c] = NULL;
+	}
+	qsort(edges, len, sizeof(*edges), hedge_arena_cmp);
+
+	a->max_free = 0;
+	a->free_size = 0;
+	a->released = 0;
+
+	size_t i = 0;
+	while(i < len) {
+		HEdge* e = edges[i];
+		uint8_t* end = (uint8_t*) e + hedge_sizeof(e->rank);
+		for(i++; i < len && (uint8_t*) edges[i] == end; i++)
+			end += hedge_sizeof(edges[i]->rank);
+
+		e->rank = (end - (uint8_t*) e - hedge_sizeof(0)) / sizeof(uint64_t);
+		hedge_arena_push(a, e);
+	}
+
+	free(edges);
+}
+
+HEdge* hedge_arena_alloc(HEdgeArena* a, size_t rank) {
+	HEdge* e = hedge_arena_take(a, rank);
+	if(e)
+		return e;
+
+	size_t size = hedge_sizeof(rank);
+	HEdgeSlab* s = a->slabs;
+	bool full = !s || s->cap - s->len < size;
+
+	// Merging takes time proportional to the number of released edges, so they are only merged again after
+	// at least half of them were released since the last time, or an eighth of them before another slab is needed.
+	if(a->free_size >= size && (2 * a->released >= a->free_size || (full && 8 * a->released >= a->free_size))) {
+		hedge_arena_coalesce(a);
+		if((e = hedge_arena_take(a, rank)))
+			return e;
+	}
+
+	if(full) {
+		// a large edge gets an own slab
+		if(!(s = hedge_arena_add_slab(a, size, false)))
+			return NULL;
+	}
+
+	e = (HEdge*) ((uint8_t*) s->data + s->len);
+	s->len += size;
+
+	e->rank = rank;
+	return e;
+}
+
+int hedge_arena_merge(HEdgeArena* dst, HEdgeArena* src) {
+	for(size_t c = 0; c <= src->max_free; c++) {
+		HEdge* e = src->free[c];
+		if(!e)
+			continue;
+
+		while(hedge_arena_next(e))
+			e = hedge_arena_next(e);
+		hedge_arena_next(e) = dst->free[c];
+		dst->free[c] = src->free[c];
+		src->free[c] = NULL;
+	}
+
+	dst->max_free = MAX(dst->max_free, src->max_free);
+	dst->free_size += src->free_size;
+	dst->released += src->released;
+	src->max_free = 0;
+	src->free_size = 0;
+	src->released = 0;
+
+	if(src->slabs) {
+		HEdgeSlab* last = src->slabs;
+		while(last->next)
+			last = last->next;
+
+		// the current slab of `dst` stays the first one
+		if(dst->slabs) {
+			last->next = dst->slabs->next;
+			dst->slabs->next = src->slabs;
+		}
+		else
+			dst->slabs = src->slabs;
+		src->slabs = NULL;
+	}
+
+	dst->mem_size += src->mem_size;
+	src->mem_size = 0;
+	return 0;
+}
+
+void hedge_arena_free(HEdgeArena* a, HEdge* e) {
+	if(!e)
+		return;
+
+	hedge_arena_push(a, e);
+	a->released += hedge_sizeof(e->rank);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file hedge_arena.h
+ * @author FR
+ */
+
+#ifndef HEDGE_ARENA_H
+#define HEDGE_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct _HEdge HEdge;
+
+// Memory block the edges are cut from
+typedef struct _HEdgeSlab {
+	struct _HEdgeSlab* next;
+	size_t len; // number of used bytes
+	size_t cap;
+	size_t mapped; // size of the mapping if the slab is stored in the file of the arena, otherwise 0
+	uint64_t data[0];
+} HEdgeSlab;
+
+// Released edges with a lower rank are kept in a free list of their rank,
+// higher ranks share a free list for each power of two.
+#define HEDGE_ARENA_EXACT_RANKS 64
+#define HEDGE_ARENA_CLASSES (HEDGE_ARENA_EXACT_RANKS + 58) // 58 powers of two from 2^6 to 2^63
+
+// Allocator for edges, the memory of the edges is taken from large slabs.
+// Released edges are kept in free lists and are reused for new edges of any rank:
+// a new edge takes a released edge of its rank or is split from a larger released edge.
+// If there is none, the released edges that are adjacent in memory are merged before another slab is used.
+// The memory of all edges is freed at once when the arena is destroyed.
+//
+// If a limit is set, the slabs exceeding the limit are mapped from a temporary file,
+// so the kernel can write the edges to the disk instead of keeping them in memory.
+typedef struct {
+	HEdgeSlab* slabs; // the first slab is the one new edges are cut from
+	HEdge* free[HEDGE_ARENA_CLASSES]; // free lists of released edges, see `hedge_arena_class`
+	size_t max_free; // no free list of a higher class contains edges
+	size_t free_size; // size of the released edges in bytes
+	size_t released; // size of the edges released since the released edges were merged the last time
+
+	size_t limit; // maximum size of the slabs in memory in bytes, 0 for no limit
+	size_t mem_size; // size of the slabs in memory in bytes
+	FILE* file; // temporary file of the mapped slabs, NULL if no slab is mapped
+	size_t file_size;
+} HEdgeArena;
+
+HEdgeArena* hedge_arena_init();
+// frees the memory of all edges of the arena
+void hedge_arena_destroy(HEdgeArena* a);
+
+// Ensures that edges with a total size of `size` bytes can be allocated without allocating another slab,
+// as long as no released edges are reused. `hedge_sizeof` gives the size of an edge.
+int hedge_arena_reserve(HEdgeArena* a, size_t size);
+
+// the label of the edge is not initialized
+HEdge* hedge_arena_alloc(HEdgeArena* a, size_t rank);
+// the edge must have been allocated by the arena and its rank must not have been changed
+void hedge_arena_free(HEdgeArena* a, HEdge* e);
+
+// Sets the limit of the slabs in memory, the limit only applies to slabs allocated afterwards.
+// Without mmap support, all slabs stay in memory.
+void hedge_arena_set_limit(HEdgeArena* a, size_t limit);
+// Releases the pages of the mapped slabs from the memory of the process, the edges are kept in the file.
+void hedge_arena_release(HEdgeArena* a);
+
+// Moves the slabs and the released edges of `src` to `dst`, so the edges of `src` are freed with `dst`.
+// `src` is empty afterwards, but still has to be destroyed. Mapped slabs of `src` stay valid
+// after its temporary file is closed, because a mapping keeps the file open.
+int hedge_arena_merge(HEdgeArena* dst, HEdgeArena* src);
+
+#endif
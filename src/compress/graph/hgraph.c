@@ -9,7 +9,7 @@
 #include <assert.h>
 #include <arith.h>
 
-HGraph* hgraph_init(int rank) {
+HGraph* hgraph_init(int rank, HEdgeArena* arena) {
 	HGraph* g = malloc(sizeof(*g));
 	if(!g)
 		return NULL;
@@ -18,16 +18,23 @@ HGraph* hgraph_init(int rank) {
 	g->cap = 0;
 	g->edges = NULL;
 	g->rank = rank;
+	g->arena = arena;
 	return g;
 }
 
 void hgraph_destroy(HGraph* g) {
-	if(g->edges) {
-		for(size_t i = 0; i < g->len; i++)
-			free(g->edges[i]);
-		free(g->edges);
+	for(size_t i = 0; i < g->len; i++) {
+		if(g->edges[i])
+			hedge_arena_free(g->arena, g->edges[i]);
 	}
 
+	hgraph_destroy_without_edges(g);
+}
+
+void hgraph_destroy_without_edges(HGraph* g) {
+	if(g->edges)
+		free(g->edges);
+
 	free(g);
 }
 
@@ -60,6 +67,20 @@ int hgraph_add_edge(HGraph* g, HEdge* e) {
 	return 0;
 }
 
+int hgraph_reserve(HGraph* g, size_t cap) {
+	if(cap <= g->cap)
+		return 0;
+
+	HEdge** edges_new = realloc(g->edges, cap * sizeof(HEdge*));
+	if(!edges_new)
+		return -1;
+
+	g->cap = cap;
+	g->edges = edges_new;
+
+	return 0;
+}
+
 HEdge* hgraph_edge_get(const HGraph* g, size_t i) {
 	assert(i < g->len);
 
@@ -75,14 +96,14 @@ void hgraph_edge_set(HGraph* g, size_t i, HEdge* e) {
 void hgraph_edge_replace(HGraph* g, size_t i, HEdge* e) {
 	assert(i < g->len);
 
-	free(g->edges[i]);
+	hedge_arena_free(g->arena, g->edges[i]);
 	g->edges[i] = e;
 }
 
 void hgraph_edge_free(HGraph* g, size_t i) {
 	assert(i < g->len);
 
-	free(g->edges[i]);
+	hedge_arena_free(g->arena, g->edges[i]);
 	g->edges[i] = NULL;
 }
 
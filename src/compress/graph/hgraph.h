@@ -8,10 +8,11 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <hedge_arena.h>
 
 #define RANK_NONE (-1)
 
-typedef struct {
+typedef struct _HEdge {
 	uint64_t label;
 	size_t rank;
 	uint64_t nodes[0];
@@ -25,12 +26,20 @@ typedef struct {
 	size_t cap;
 	HEdge** edges;
 	int rank;
+	HEdgeArena* arena; // memory of the edges, not owned by the graph
 } HGraph;
 
-HGraph* hgraph_init(int rank);
+HGraph* hgraph_init(int rank, HEdgeArena* arena);
 void hgraph_destroy(HGraph* g);
+// Does not release the edges, used if the arena of the edges is destroyed anyway
+void hgraph_destroy_without_edges(HGraph* g);
+
+// allocates an edge in the arena of the graph, but does not add it to the graph
+#define hgraph_edge_alloc(g, rank) hedge_arena_alloc((g)->arena, (rank))
 
 int hgraph_add_edge(HGraph* g, HEdge* e);
+// ensures that at least `cap` edges can be stored without reallocating
+int hgraph_reserve(HGraph* g, size_t cap);
 #define hgraph_len(g) ((g)->len)
 
 HEdge* hgraph_edge_get(const HGraph* g, size_t i);
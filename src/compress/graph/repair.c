@@ -6,12 +6,17 @@
 #include "repair.h"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 #include <slhr_grammar.h>
 #include <hgraph.h>
-#include <hashmap.h>
+#include <flatmap.h>
+#include <pqueue.h>
 #include <repair_types.h>
 #include <rule_creator.h>
 #include <arith.h>
@@ -30,31 +35,18 @@ static int cmp_adjacency_type(const AdjacencyType* a1, const AdjacencyType* a2)
 	return 0;
 }
 
-static inline Hash hash_adjacency_type(const AdjacencyType* a) {
-	Hash h = 0;
-	HASH_COMBINE(h, HASH(a->label));
-	HASH_COMBINE(h, HASH(a->conn_type));
-	return h;
-}
-
-static int cmp_adjacency_type_cb(const void* k1, size_t l1, const void* k2, size_t l2) {
-	assert(l1 == sizeof(AdjacencyType) && l2 == sizeof(AdjacencyType));
-
-	return cmp_adjacency_type(k1, k2);
+static inline bool eq_adjacency_type(const AdjacencyType* a1, const AdjacencyType* a2) {
+	return a1->label == a2->label && a1->conn_type == a2->conn_type;
 }
 
-static Hash hash_adjacency_type_cb(const void* k, size_t l) {
-	assert(l == sizeof(AdjacencyType));
-
-	return hash_adjacency_type(k);
+static inline uint64_t hash_adjacency_type(const AdjacencyType* a) {
+	uint64_t h = 0;
+	FLATMAP_HASH_COMBINE(h, a->label);
+	FLATMAP_HASH_COMBINE(h, a->conn_type);
+	return h;
 }
 
-static int cmp_digram_type_cb(const void* k1, size_t l1, const void* k2, size_t l2) {
-	assert(l1 == sizeof(Digram) && l2 == sizeof(Digram));
-
-	const Digram* d1 = k1;
-	const Digram* d2 = k2;
-
+static inline int cmp_digram(const Digram* d1, const Digram* d2) {
 	// compare first adjacancy type
 	int cmp = cmp_adjacency_type(&d1->adj0, &d2->adj0);
 	if(cmp != 0)
@@ -63,23 +55,20 @@ static int cmp_digram_type_cb(const void* k1, size_t l1, const void* k2, size_t
 	return cmp_adjacency_type(&d1->adj1, &d2->adj1);
 }
 
-static Hash hash_digram_type_cb(const void* k, size_t l) {
-	assert(l == sizeof(Digram));
-
-	const Digram* d = k;
+static inline bool eq_digram(const Digram* d1, const Digram* d2) {
+	return eq_adjacency_type(&d1->adj0, &d2->adj0) && eq_adjacency_type(&d1->adj1, &d2->adj1);
+}
 
-	Hash h = 0;
-	HASH_COMBINE(h, hash_adjacency_type(&d->adj0));
-	HASH_COMBINE(h, hash_adjacency_type(&d->adj1));
+static inline uint64_t hash_digram(const Digram* d) {
+	uint64_t h = 0;
+	FLATMAP_HASH_COMBINE(h, d->adj0.label);
+	FLATMAP_HASH_COMBINE(h, d->adj0.conn_type);
+	FLATMAP_HASH_COMBINE(h, d->adj1.label);
+	FLATMAP_HASH_COMBINE(h, d->adj1.conn_type);
 	return h;
 }
 
-static int cmp_monogram_type_cb(const void* k1, size_t l1, const void* k2, size_t l2) {
-	assert(l1 == sizeof(Monogram) && l2 == sizeof(Monogram));
-
-	const Monogram* m1 = k1;
-	const Monogram* m2 = k2;
-
+static inline int cmp_monogram(const Monogram* m1, const Monogram* m2) {
 	if(m1->label != m2->label)
 		return CMP(m1->label, m2->label);
 	if(m1->conn0 != m2->conn0)
@@ -87,211 +76,1179 @@ static int cmp_monogram_type_cb(const void* k1, size_t l1, const void* k2, size_
 	return CMP(m1->conn1, m2->conn1);
 }
 
-static Hash hash_monogram_type_cb(const void* k, size_t l) {
-	assert(l == sizeof(Monogram));
-
-	const Monogram* m = k;
+static inline bool eq_monogram(const Monogram* m1, const Monogram* m2) {
+	return m1->label == m2->label && m1->conn0 == m2->conn0 && m1->conn1 == m2->conn1;
+}
 
-	Hash h = HASH(m->label);
-	HASH_COMBINE(h, HASH(m->conn0));
-	HASH_COMBINE(h, HASH(m->conn1));
+static inline uint64_t hash_monogram(const Monogram* m) {
+	uint64_t h = 0;
+	FLATMAP_HASH_COMBINE(h, m->label);
+	FLATMAP_HASH_COMBINE(h, m->conn0);
+	FLATMAP_HASH_COMBINE(h, m->conn1);
 	return h;
 }
 
-static int cmp_uint_cb(const void* k1, size_t l1, const void* k2, size_t l2) {
-	assert(l1 == sizeof(uint64_t) && l2 == sizeof(uint64_t));
+static inline bool eq_uint(const uint64_t* v1, const uint64_t* v2) {
+	return *v1 == *v2;
+}
 
-	const uint64_t* n1 = k1;
-	const uint64_t* n2 = k2;
-	return CMP(*n1, *n2);
+static inline uint64_t hash_uint(const uint64_t* v) {
+	return flatmap_mix64(*v);
 }
 
-static Hash hash_uint_cb(const void* k, size_t l) {
-	assert(l == sizeof(uint64_t));
+// Maps used by the algorithms
 
-	const uint64_t* v = k;
-	return HASH(*v);
-}
+FLATMAP_DEFINE(DigramDeltaMap, digram_delta_map, Digram, int64_t, hash_digram, eq_digram)
+FLATMAP_DEFINE(MonogramCountMap, monogram_count_map, Monogram, uint64_t, hash_monogram, eq_monogram)
+FLATMAP_DEFINE(CountHistogram, count_histogram, uint64_t, size_t, hash_uint, eq_uint)
 
 // Algorithms
 
+typedef struct {
+	AdjacencyType adj;
+	uint64_t count;
+} AdjacencyCount;
+
+// The adjacency types of a node with their frequencies.
+// The number of different adjacency types of a node is small, so a list is searched faster than a map.
+typedef struct {
+	uint32_t len;
+	uint32_t cap;
+	AdjacencyCount* data; // either points into the pool of the dict or to its own memory
+} NodeAdjacency;
+
+// The adjacency types of all nodes are initially stored consecutively in one pool (like in the CSR format).
+// Only if the list of a node grows beyond its space in the pool, it is moved to its own memory.
 typedef struct {
 	size_t nodes;
-	Hashmap** dict;
+	NodeAdjacency* dict;
+
+	size_t pool_len;
+	AdjacencyCount* pool;
 } NodeAdjacencyDict;
 
-static int repair_create_node_adjacency_dict(HGraph* rule, size_t nodes, NodeAdjacencyDict* dict) {
-	Hashmap** node_adjacency_dict = calloc(nodes, sizeof(Hashmap*)); // initialize with zero
-	if(!node_adjacency_dict)
-		return -1;
+static inline bool node_adjacency_in_pool(const NodeAdjacencyDict* dict, const NodeAdjacency* n) {
+	return n->data >= dict->pool && n->data < dict->pool + dict->pool_len;
+}
 
-	HEdge* edge;
-	AdjacencyType adj_type;
-	uint64_t node;
-	Hashmap* adjacency_frequency_dir;
-	uint64_t count_init; // used to initialize a counter of a adjacency type
+static inline AdjacencyCount* node_adjacency_get(NodeAdjacency* n, const AdjacencyType* adj) {
+	for(uint32_t i = 0; i < n->len; i++)
+		if(n->data[i].adj.label == adj->label && n->data[i].adj.conn_type == adj->conn_type)
+			return n->data + i;
+	return NULL;
+}
 
-	size_t len = hgraph_len(rule);
-	for(size_t i = 0; i < len; i++) {
-		edge = hgraph_edge_get(rule, i);
+// The adjacency type must not exist in the list of the node.
+static AdjacencyCount* node_adjacency_add(NodeAdjacencyDict* dict, NodeAdjacency* n, const AdjacencyType* adj) {
+	if(n->len == n->cap) {
+		uint32_t cap = n->cap < 4 ? 4 : (n->cap + (n->cap >> 1));
+		AdjacencyCount* tmp;
 
-		adj_type.label = edge->label;
+		if(node_adjacency_in_pool(dict, n)) {
+			if((tmp = malloc(cap * sizeof(*tmp))) != NULL)
+				memcpy(tmp, n->data, n->len * sizeof(*tmp));
+		}
+		else
+			tmp = realloc(n->data, cap * sizeof(*tmp));
+		if(!tmp)
+			return NULL;
 
-		for(size_t connection_type = 0; connection_type < edge->rank; connection_type++) {
-			node = edge->nodes[connection_type];
-            assert(node < nodes); //Important, reduces many not obvious mistakes I made that are not the fault of this method.
+		n->cap = cap;
+		n->data = tmp;
+	}
 
-			adj_type.conn_type = connection_type;
+	AdjacencyCount* c = n->data + n->len++;
+	c->adj = *adj;
+	c->count = 0;
+	return c;
+}
 
-			if(node_adjacency_dict[node] != NULL) {
-				adjacency_frequency_dir = node_adjacency_dict[node];
+// The entry must be part of the list of the node.
+static inline void node_adjacency_remove(NodeAdjacency* n, AdjacencyCount* c) {
+	*c = n->data[--n->len];
+}
 
-				uint64_t* count = hashmap_get(adjacency_frequency_dir, &adj_type, sizeof(adj_type), NULL);
-				if(count)
-					// because a pointer to the value is returned,
-					// the value at the given address can be increased.
-					(*count)++;
-				else {
-					count_init = 1;
-					hashmap_put(adjacency_frequency_dir, &adj_type, sizeof(adj_type), &count_init, sizeof(count_init));
-				}
-			}
-			else {
-				adjacency_frequency_dir = hashmap_init(cmp_adjacency_type_cb, hash_adjacency_type_cb);
-				if(!adjacency_frequency_dir)
-					goto err0;
+static void node_adjacency_dict_destroy(NodeAdjacencyDict* dict) {
+	for(size_t i = 0; i < dict->nodes; i++) {
+		NodeAdjacency* n = dict->dict + i;
+		if(n->data && !node_adjacency_in_pool(dict, n))
+			free(n->data);
+	}
+	free(dict->dict);
+	if(dict->pool)
+		free(dict->pool);
+}
 
-				count_init = 1;
-				hashmap_put(adjacency_frequency_dir, &adj_type, sizeof(adj_type), &count_init, sizeof(count_init));
+// Runs `fn` for each of the `threads` arguments in `args`, where each argument has a size of `arg_size` bytes.
+// The first argument is processed by the calling thread. If a thread could not be created,
+// its argument is processed by the calling thread as well.
+static void repair_run_parallel(int threads, void* (*fn)(void*), void* args, size_t arg_size) {
+	pthread_t* ids = threads > 1 ? malloc((threads - 1) * sizeof(*ids)) : NULL;
+	bool* started = threads > 1 ? calloc(threads - 1, sizeof(*started)) : NULL;
+
+	int i;
+	if(ids && started) {
+		for(i = 1; i < threads; i++)
+			started[i - 1] = pthread_create(&ids[i - 1], NULL, fn, (char*) args + i * arg_size) == 0;
+	}
+
+	fn(args);
+
+	for(i = 1; i < threads; i++) {
+		if(ids && started && started[i - 1])
+			pthread_join(ids[i - 1], NULL);
+		else
+			fn((char*) args + i * arg_size);
+	}
+
+	if(ids)
+		free(ids);
+	if(started)
+		free(started);
+}
 
-				node_adjacency_dict[node] = adjacency_frequency_dir;
+// Incidence of a node at an edge of the rule
+typedef struct {
+	size_t edge;
+	size_t conn_type;
+} Incidence;
+
+typedef struct {
+	size_t len;
+	Incidence* data;
+} IncidenceList;
+
+typedef struct {
+	HGraph* rule;
+	NodeAdjacencyDict* dict;
+	int threads;
+	int index; // index of the worker
+	size_t nodes_per_worker; // the worker adds the adjacency types of the nodes [index * nodes_per_worker, (index + 1) * nodes_per_worker)
+	size_t edges_from; // range of edges whose incidences are distributed by this worker
+	size_t edges_to;
+	// The incidences of the edges of worker `i` at the nodes of worker `j` are in `lists[i * threads + j]`.
+	// NULL if there is only one worker, then all edges are processed directly.
+	IncidenceList* lists;
+	int res;
+} AdjacencyDictWorker;
+
+// Distributes the incidences of the edges of the worker to the lists of the workers of the nodes.
+// The lists are filled in the order of the edges.
+static void* repair_adjacency_dict_split_worker(void* arg) {
+	AdjacencyDictWorker* w = arg;
+	IncidenceList* lists = w->lists + w->index * w->threads;
+
+	size_t i, connection_type;
+	for(i = w->edges_from; i < w->edges_to; i++) {
+		HEdge* edge = hgraph_edge_get(w->rule, i);
+		for(connection_type = 0; connection_type < edge->rank; connection_type++) {
+			assert(edge->nodes[connection_type] < w->dict->nodes); //Important, reduces many not obvious mistakes I made that are not the fault of this method.
+			lists[edge->nodes[connection_type] / w->nodes_per_worker].len++;
+		}
+	}
+
+	int j;
+	for(j = 0; j < w->threads; j++) {
+		if(lists[j].len > 0 && !(lists[j].data = malloc(lists[j].len * sizeof(*lists[j].data)))) {
+			w->res = -1;
+			return NULL;
+		}
+		lists[j].len = 0;
+	}
+
+	for(i = w->edges_from; i < w->edges_to; i++) {
+		HEdge* edge = hgraph_edge_get(w->rule, i);
+		for(connection_type = 0; connection_type < edge->rank; connection_type++) {
+			IncidenceList* l = lists + edge->nodes[connection_type] / w->nodes_per_worker;
+			l->data[l->len].edge = i;
+			l->data[l->len].conn_type = connection_type;
+			l->len++;
+		}
+	}
+
+	return NULL;
+}
+
+static inline void repair_adjacency_dict_fill(NodeAdjacency* n, uint64_t label, size_t connection_type) {
+	AdjacencyType adj_type = {label, connection_type};
+
+	AdjacencyCount* c = node_adjacency_get(n, &adj_type);
+	if(!c) {
+		// the capacity in the pool is the number of incidences, so there is always space
+		c = n->data + n->len++;
+		c->adj = adj_type;
+		c->count = 0;
+	}
+	c->count++;
+}
+
+// Counts the incidences of the nodes in the range of the worker.
+// The number of incidences of a node is the upper bound of its adjacency types.
+static void* repair_adjacency_dict_count_worker(void* arg) {
+	AdjacencyDictWorker* w = arg;
+	NodeAdjacency* dict = w->dict->dict;
+
+	if(!w->lists) {
+		size_t len = hgraph_len(w->rule);
+		for(size_t i = 0; i < len; i++) {
+			HEdge* edge = hgraph_edge_get(w->rule, i);
+
+			for(size_t connection_type = 0; connection_type < edge->rank; connection_type++) {
+				assert(edge->nodes[connection_type] < w->dict->nodes);
+				dict[edge->nodes[connection_type]].cap++;
 			}
 		}
+		return NULL;
+	}
+
+	for(int i = 0; i < w->threads; i++) {
+		const IncidenceList* l = w->lists + i * w->threads + w->index;
+		for(size_t j = 0; j < l->len; j++) {
+			HEdge* edge = hgraph_edge_get(w->rule, l->data[j].edge);
+			dict[edge->nodes[l->data[j].conn_type]].cap++;
+		}
 	}
 
+	return NULL;
+}
+
+// Adds the adjacency types of all nodes in the range of the worker to the dict.
+// The lists of the workers are processed in the order of their edges,
+// so the dict is the same as if all edges were processed by a single thread.
+static void* repair_adjacency_dict_fill_worker(void* arg) {
+	AdjacencyDictWorker* w = arg;
+	NodeAdjacency* dict = w->dict->dict;
+
+	if(!w->lists) {
+		size_t len = hgraph_len(w->rule);
+		for(size_t i = 0; i < len; i++) {
+			HEdge* edge = hgraph_edge_get(w->rule, i);
+
+			for(size_t connection_type = 0; connection_type < edge->rank; connection_type++)
+				repair_adjacency_dict_fill(dict + edge->nodes[connection_type], edge->label, connection_type);
+		}
+		return NULL;
+	}
+
+	for(int i = 0; i < w->threads; i++) {
+		const IncidenceList* l = w->lists + i * w->threads + w->index;
+		for(size_t j = 0; j < l->len; j++) {
+			HEdge* edge = hgraph_edge_get(w->rule, l->data[j].edge);
+			size_t connection_type = l->data[j].conn_type;
+			repair_adjacency_dict_fill(dict + edge->nodes[connection_type], edge->label, connection_type);
+		}
+	}
+
+	return NULL;
+}
+
+static void incidence_lists_destroy(IncidenceList* lists, int threads) {
+	if(!lists)
+		return;
+
+	for(int i = 0; i < threads * threads; i++)
+		if(lists[i].data)
+			free(lists[i].data);
+	free(lists);
+}
+
+// The edges and the nodes are split into one range per thread. First, each thread distributes the incidences
+// of its edges to the threads of their nodes, then each thread adds the adjacency types of its nodes.
+// This way, every edge is only read by one thread to distribute its incidences.
+static int repair_create_node_adjacency_dict(HGraph* rule, size_t nodes, int threads, NodeAdjacencyDict* dict) {
 	dict->nodes = nodes;
-	dict->dict = node_adjacency_dict;
+	dict->dict = calloc(nodes, sizeof(*dict->dict)); // initialize with zero
+	dict->pool_len = 0;
+	dict->pool = NULL;
+	if(!dict->dict)
+		return -1;
+
+	if(threads < 1)
+		threads = 1;
+	if((size_t) threads > nodes)
+		threads = nodes > 0 ? nodes : 1;
+
+	AdjacencyDictWorker* workers = malloc(threads * sizeof(*workers));
+	if(!workers)
+		goto err0;
+
+	IncidenceList* lists = NULL;
+	if(threads > 1 && !(lists = calloc(threads * threads, sizeof(*lists))))
+		goto err1;
+
+	size_t edges = hgraph_len(rule);
+	size_t nodes_per_worker = (nodes + threads - 1) / threads;
+
+	int i;
+	for(i = 0; i < threads; i++) {
+		workers[i].rule = rule;
+		workers[i].dict = dict;
+		workers[i].threads = threads;
+		workers[i].index = i;
+		workers[i].nodes_per_worker = nodes_per_worker;
+		workers[i].edges_from = edges * i / threads;
+		workers[i].edges_to = edges * (i + 1) / threads;
+		workers[i].lists = lists;
+		workers[i].res = 0;
+	}
+
+	if(lists) {
+		repair_run_parallel(threads, repair_adjacency_dict_split_worker, workers, sizeof(*workers));
+		for(i = 0; i < threads; i++)
+			if(workers[i].res < 0)
+				goto err2;
+	}
+
+	// reserve space in the pool for each incidence of a node
+	repair_run_parallel(threads, repair_adjacency_dict_count_worker, workers, sizeof(*workers));
+
+	size_t node, pool_len = 0;
+	for(node = 0; node < nodes; node++)
+		pool_len += dict->dict[node].cap;
+
+	if(pool_len > 0 && !(dict->pool = malloc(pool_len * sizeof(*dict->pool))))
+		goto err2;
+
+	size_t offset = 0;
+	for(node = 0; node < nodes; node++) {
+		NodeAdjacency* n = dict->dict + node;
+		n->data = n->cap > 0 ? dict->pool + offset : NULL;
+		offset += n->cap;
+	}
+
+	repair_run_parallel(threads, repair_adjacency_dict_fill_worker, workers, sizeof(*workers));
+	incidence_lists_destroy(lists, threads);
+
+	// Most nodes have less adjacency types than incidences, so the pool is compacted.
+	offset = 0;
+	for(node = 0; node < nodes; node++) {
+		NodeAdjacency* n = dict->dict + node;
+		if(n->len > 0)
+			memmove(dict->pool + offset, n->data, n->len * sizeof(*dict->pool));
+		n->cap = n->len;
+		offset += n->len;
+	}
+
+	if(offset > 0 && offset < pool_len) {
+		AdjacencyCount* tmp = realloc(dict->pool, offset * sizeof(*tmp));
+		if(tmp)
+			dict->pool = tmp;
+	}
+	dict->pool_len = offset;
+
+	offset = 0;
+	for(node = 0; node < nodes; node++) {
+		NodeAdjacency* n = dict->dict + node;
+		n->data = n->len > 0 ? dict->pool + offset : NULL;
+		offset += n->len;
+	}
+
+	free(workers);
 	return 0;
 
+err2:
+	incidence_lists_destroy(lists, threads);
+err1:
+	free(workers);
 err0:
-	for(size_t i = 0; i < nodes; i++)
-		if(node_adjacency_dict[i])
-			hashmap_destroy(node_adjacency_dict[i]);
-	free(node_adjacency_dict);
+	free(dict->dict);
 	return -1;
 }
 
-// delta is signed to allow negative values
-static int update_digram_count_delta(Hashmap* digram_count, Digram* digram, int64_t delta) {
-	Digram inverted;
+// Digram counter
+
+typedef struct {
+	Digram digram; // in the orientation in which it was counted first, the rule of the digram has the same order
+	int64_t count; // signed value to allow negative values, index of the next unused entry if the entry is unused
+	int64_t queued_count; // frequency by which the entry is ordered in the queue, never lower than `count`
+} DigramCountEntry;
+
+#define DIGRAM_SPILL_BITS 6
+#define DIGRAM_SPILL_BUCKETS (1 << DIGRAM_SPILL_BITS)
+#define DIGRAM_SPILL_BLOCK 4096 // number of records read at once
+#define DIGRAM_SPILL_RELOAD_MARGIN 8 // the spilled digrams are reloaded if their highest frequency is 1/8 higher than the head
+
+typedef struct {
+	Digram digram;
+	int64_t count;
+} DigramSpillRecord;
+
+// Digrams that do not fit into the memory are written to temporary files.
+// The digrams are distributed over the files by their hash value, so all records of a digram
+// are in the same file and the files can be aggregated one after another with little memory.
+//
+// While a digram is spilled, increments of its frequency are counted by a new entry in memory and decrements
+// are appended as negative records, so the sum of all records and the entry is the frequency of the digram.
+// The digrams in memory are only compared with the highest record to decide if spilled digrams are loaded again,
+// so a digram whose records are not aggregated yet may be replaced later than in memory. This may result in
+// a worse compression, but not in a wrong grammar, because the occurrences are searched in the start rule.
+//
+// The files are created once and reused with `ftruncate` after they are read. While a bucket is read,
+// its new records are written to the spare file, which replaces the file of the bucket.
+typedef struct {
+	FILE* buckets[DIGRAM_SPILL_BUCKETS]; // NULL if nothing was written to the bucket yet
+	FILE* spare; // empty file, NULL if it is not created yet
+	size_t len; // number of records in all buckets
+	size_t aggregated_len; // number of records after the last aggregation
+	int64_t max_count; // highest frequency of a record
+	pthread_mutex_t lock; // the digrams are spilled by several threads while they are counted
+} DigramSpill;
+
+static void digram_spill_init(DigramSpill* s) {
+	memset(s->buckets, 0, sizeof(s->buckets));
+	s->spare = NULL;
+	s->len = 0;
+	s->aggregated_len = 0;
+	s->max_count = 0;
+	pthread_mutex_init(&s->lock, NULL);
+}
 
-	int64_t* val; // signed value to allow negative values
-	if((val = hashmap_get(digram_count, digram, sizeof(*digram), NULL))) {
-		*val += delta;
-		if(*val <= 0)
-			hashmap_remove(digram_count, digram, sizeof(*digram));
+static void digram_spill_destroy(DigramSpill* s) {
+	for(size_t b = 0; b < DIGRAM_SPILL_BUCKETS; b++)
+		if(s->buckets[b])
+			fclose(s->buckets[b]); // temporary files are deleted automatically
+	if(s->spare)
+		fclose(s->spare);
+	pthread_mutex_destroy(&s->lock);
+}
+
+// The upper bits of the hash value are used, because the lower bits determine the position in the maps.
+static inline size_t digram_spill_bucket(const Digram* d) {
+	return hash_digram(d) >> (64 - DIGRAM_SPILL_BITS);
+}
+
+// digram must be normalized
+static int digram_spill_write(DigramSpill* s, const Digram* digram, int64_t count) {
+	size_t b = digram_spill_bucket(digram);
+	if(!s->buckets[b] && !(s->buckets[b] = tmpfile()))
+		return -1;
+
+	DigramSpillRecord r = {*digram, count};
+	if(fwrite(&r, sizeof(r), 1, s->buckets[b]) != 1)
+		return -1;
+
+	s->len++;
+	if(count > s->max_count)
+		s->max_count = count;
+	return 0;
+}
+
+// Writes all digrams of the map to the disk and clears the map.
+static int digram_spill_write_map(DigramSpill* s, DigramDeltaMap* m) {
+	int res = 0;
+	pthread_mutex_lock(&s->lock);
+
+	size_t pos = 0;
+	DigramDeltaMapEntry* e;
+	while(res == 0 && (e = digram_delta_map_next(m, &pos)) != NULL)
+		res = digram_spill_write(s, &e->key, e->val);
+
+	pthread_mutex_unlock(&s->lock);
+	digram_delta_map_clear(m);
+	return res;
+}
+
+// Replaces the file of the bucket by the spare file and sets the old file to its beginning, so it can be read
+// while new records of the bucket are written. The file must be returned with `digram_spill_release`.
+static FILE* digram_spill_take(DigramSpill* s, size_t b) {
+	FILE* f = s->buckets[b];
+	if(!f)
+		return NULL;
+
+	s->buckets[b] = s->spare;
+	s->spare = NULL;
+	rewind(f);
+	return f;
+}
+
+// Empties a file taken from a bucket and keeps it as the spare file.
+// On errors, the file is closed and a new one is created when it is needed.
+static int digram_spill_release(DigramSpill* s, FILE* f) {
+	bool failed = ferror(f);
+
+	rewind(f);
+	if(failed || ftruncate(fileno(f), 0) < 0) {
+		fclose(f);
+		return -1;
+	}
+
+	if(s->spare)
+		fclose(f);
+	else
+		s->spare = f;
+	return 0;
+}
+
+// The frequencies of the digrams are stored in a list of entries.
+// The indices of the entries are used as the ids of the indexed priority queue,
+// which always contains the most frequent digram at its head. This way, the next digram
+// to replace is determined without iterating over all digrams.
+//
+// The ids are found by a hash table with open addressing, which only stores the ids
+// and takes the digrams from the entries, so every digram is stored once.
+// Both orientations of a digram are the same digram, so the table is searched by the normalized digram.
+// Unused entries are linked by their `count` and reused for new digrams.
+//
+// Because most updates decrease the frequency of a digram, the queue is only updated
+// if a frequency increases. Decreased frequencies are fixed lazily when the entry reaches the
+// head of the queue (see `digram_count_peek`).
+typedef struct {
+	size_t size; // number of digrams
+	size_t slots_cap; // always a power of 2
+	uint32_t* slots; // id + 1 of the entry of a digram, 0 for free slots
+
+	size_t len;
+	size_t cap;
+	DigramCountEntry* entries;
+	size_t free; // first unused entry, DIGRAM_COUNT_NONE if there is none
+
+	PQueue queue;
+
+	size_t max_len; // maximum number of digrams in memory, 0 for no limit
+	DigramSpill spill; // less frequent digrams exceeding the limit
+} DigramCount;
+
+#define DIGRAM_COUNT_NONE ((size_t) -1)
+#define DIGRAM_COUNT_DEFAULT_CAPACITY 16
+
+// The most frequent digram is at the head of the queue.
+// Digrams with the same frequency are ordered by the digram itself, so the order of the
+// replacements does not depend on the order in which the digrams were counted.
+// The former hash map took the first digram of its iteration order instead and stored the digrams
+// in the orientation of the per-node hash maps of the adjacency types. Therefore, the grammar of a graph
+// can differ from the one of earlier versions, although both decompress to the same graph.
+static int cmp_digram_count_cb(size_t a, size_t b, void* ctx) {
+	const DigramCount* c = ctx;
+	const DigramCountEntry* e1 = c->entries + a;
+	const DigramCountEntry* e2 = c->entries + b;
+
+	if(e1->queued_count != e2->queued_count)
+		return e1->queued_count > e2->queued_count ? -1 : 1;
+	return cmp_digram(&e1->digram, &e2->digram);
+}
+
+// The digrams (a, b) and (b, a) are the same digram.
+// Both are stored as the digram whose first adjacency type is the smaller one.
+static inline void digram_normalize(Digram* d) {
+	if(cmp_adjacency_type(&d->adj0, &d->adj1) > 0) {
+		AdjacencyType tmp = d->adj0;
+		d->adj0 = d->adj1;
+		d->adj1 = tmp;
+	}
+}
+
+static inline uint64_t hash_digram_normalized(const Digram* d) {
+	Digram n = *d;
+	digram_normalize(&n);
+	return hash_digram(&n);
+}
+
+// Returns the slot of the normalized digram or of the free slot where it would be inserted.
+static size_t digram_count_find(const DigramCount* c, const Digram* digram, bool* found) {
+	size_t mask = c->slots_cap - 1;
+	size_t i = hash_digram(digram) & mask;
+
+	uint32_t slot;
+	while((slot = c->slots[i]) != 0) {
+		const Digram* d = &c->entries[slot - 1].digram;
+		if(eq_digram(d, digram)
+				|| (eq_adjacency_type(&d->adj0, &digram->adj1) && eq_adjacency_type(&d->adj1, &digram->adj0))) {
+			*found = true;
+			return i;
+		}
+		i = (i + 1) & mask;
+	}
+
+	*found = false;
+	return i;
+}
+
+// Returns the id of the normalized digram or DIGRAM_COUNT_NONE if it is not in memory.
+static size_t digram_count_get(const DigramCount* c, const Digram* digram) {
+	if(c->size == 0)
+		return DIGRAM_COUNT_NONE;
+
+	bool found;
+	size_t i = digram_count_find(c, digram, &found);
+	return found ? c->slots[i] - 1 : DIGRAM_COUNT_NONE;
+}
+
+static int digram_count_resize(DigramCount* c, size_t cap) {
+	uint32_t* slots = calloc(cap, sizeof(*slots));
+	if(!slots)
+		return -1;
+
+	size_t mask = cap - 1;
+	for(size_t j = 0; j < c->slots_cap; j++) {
+		if(!c->slots[j])
+			continue;
+
+		size_t i = hash_digram_normalized(&c->entries[c->slots[j] - 1].digram) & mask;
+		while(slots[i])
+			i = (i + 1) & mask;
+		slots[i] = c->slots[j];
+	}
+
+	if(c->slots)
+		free(c->slots);
+	c->slots = slots;
+	c->slots_cap = cap;
+	return 0;
+}
+
+static int digram_count_init(DigramCount* c, size_t max_len) {
+	c->size = 0;
+	c->slots_cap = 0;
+	c->slots = NULL;
+	c->len = 0;
+	c->cap = 0;
+	c->entries = NULL;
+	c->free = DIGRAM_COUNT_NONE;
+	pqueue_init(&c->queue, cmp_digram_count_cb, c);
+	c->max_len = max_len;
+	digram_spill_init(&c->spill);
+	return 0;
+}
+
+static void digram_count_destroy(DigramCount* c) {
+	if(c->slots)
+		free(c->slots);
+	if(c->entries)
+		free(c->entries);
+	pqueue_destroy(&c->queue);
+	digram_spill_destroy(&c->spill);
+}
+
+// The following slots of the cluster are moved backwards like in `FLATMAP_DEFINE`, so no tombstones are needed.
+static void digram_count_remove_id(DigramCount* c, size_t id) {
+	Digram d = c->entries[id].digram;
+	digram_normalize(&d);
+
+	bool found;
+	size_t i = digram_count_find(c, &d, &found);
+
+	size_t mask = c->slots_cap - 1;
+	size_t j = i;
+	while(true) {
+		j = (j + 1) & mask;
+		if(!c->slots[j])
+			break;
+		size_t k = hash_digram_normalized(&c->entries[c->slots[j] - 1].digram) & mask;
+		if(i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		c->slots[i] = c->slots[j];
+		i = j;
+	}
+	c->slots[i] = 0;
+	c->size--;
+
+	pqueue_remove(&c->queue, id);
+	c->entries[id].count = (int64_t) c->free;
+	c->free = id;
+}
+
+static int cmp_count_histogram_entry(const void* v1, const void* v2) {
+	const CountHistogramEntry* e1 = v1;
+	const CountHistogramEntry* e2 = v2;
+	return CMP(e1->key, e2->key);
+}
+
+// Returns the frequencies with their number of digrams in ascending order.
+static CountHistogramEntry* count_histogram_sorted(const CountHistogram* h) {
+	size_t len = count_histogram_size(h);
+	CountHistogramEntry* res = malloc(MAX(len, 1) * sizeof(*res));
+	if(!res)
+		return NULL;
+
+	size_t pos = 0, i = 0;
+	CountHistogramEntry* e;
+	while((e = count_histogram_next(h, &pos)) != NULL)
+		res[i++] = *e;
+
+	qsort(res, len, sizeof(*res), cmp_count_histogram_entry);
+	return res;
+}
+
+static inline int count_histogram_add(CountHistogram* h, uint64_t count) {
+	size_t* n = count_histogram_put(h, &count, NULL);
+	if(!n)
+		return -1;
+
+	(*n)++;
+	return 0;
+}
+
+// Moves the less frequent half of the digrams in memory to the disk.
+// The head of the queue is never spilled, so there is always a digram in memory.
+static int digram_count_spill(DigramCount* c) {
+	int res = -1;
+
+	CountHistogram h;
+	count_histogram_init(&h);
+
+	size_t id;
+	for(id = 0; id < c->len; id++) {
+		// unused entries are not in the queue
+		if(pqueue_contains(&c->queue, id) && count_histogram_add(&h, c->entries[id].count) < 0)
+			goto exit_0;
+	}
+
+	size_t len = count_histogram_size(&h);
+	if(len == 0) {
+		res = 0;
+		goto exit_0;
+	}
+
+	CountHistogramEntry* counts = count_histogram_sorted(&h);
+	if(!counts)
+		goto exit_0;
+
+	// The digrams with a frequency lower than `threshold` are spilled,
+	// of the digrams with a frequency equal to `threshold` only as many as needed.
+	size_t half = c->size / 2;
+	size_t i = 0, spilled = 0;
+	while(i < len - 1 && spilled + counts[i].val <= half)
+		spilled += counts[i++].val;
+
+	uint64_t threshold = counts[i].key;
+	size_t partial = half - spilled;
+	size_t head = pqueue_peek(&c->queue);
+
+	for(id = 0; id < c->len; id++) {
+		DigramCountEntry* e = c->entries + id;
+		if(!pqueue_contains(&c->queue, id) || id == head || (uint64_t) e->count > threshold)
+			continue;
+
+		if((uint64_t) e->count == threshold) {
+			if(partial == 0)
+				continue;
+			partial--;
+		}
+
+		Digram d = e->digram;
+		digram_normalize(&d);
+		if(digram_spill_write(&c->spill, &d, e->count) < 0)
+			goto exit_1;
+		digram_count_remove_id(c, id);
+	}
+
+	res = 0;
+
+exit_1:
+	free(counts);
+exit_0:
+	count_histogram_destroy(&h);
+	return res;
+}
+
+// The digram is stored in the given orientation.
+static int digram_count_add(DigramCount* c, const Digram* digram, int64_t count) {
+	// the counter is full
+	if(c->max_len > 0 && c->size >= c->max_len && digram_count_spill(c) < 0)
+		return -1;
+
+	// the load factor is at most 3/4
+	if((c->size + 1) * 4 > c->slots_cap * 3) {
+		if(digram_count_resize(c, c->slots_cap == 0 ? DIGRAM_COUNT_DEFAULT_CAPACITY : 2 * c->slots_cap) < 0)
+			return -1;
 	}
+
+	size_t id = c->free;
+	if(id != DIGRAM_COUNT_NONE)
+		c->free = (size_t) c->entries[id].count;
 	else {
-		inverted.adj0 = digram->adj1;
-		inverted.adj1 = digram->adj0;
+		if(c->len == UINT32_MAX - 1) // the ids must fit into the slots
+			return -1;
+
+		if(c->len == c->cap) {
+			size_t cap_new = c->cap < 8 ? 8 : (c->cap + (c->cap >> 1));
+			DigramCountEntry* tmp = realloc(c->entries, cap_new * sizeof(*tmp));
+			if(!tmp)
+				return -1;
 
-		if((val = hashmap_get(digram_count, &inverted, sizeof(inverted), NULL))) {
-			*val += delta;
-			if(*val <= 0)
-				hashmap_remove(digram_count, &inverted, sizeof(inverted));
+			c->cap = cap_new;
+			c->entries = tmp;
 		}
-		else if(delta > 0) {
-			if(hashmap_put(digram_count, digram, sizeof(*digram), &delta, sizeof(delta)) < 0)
+		id = c->len++;
+	}
+
+	c->entries[id].digram = *digram;
+	c->entries[id].count = count;
+	c->entries[id].queued_count = count;
+
+	if(pqueue_push(&c->queue, id) < 0) {
+		c->entries[id].count = (int64_t) c->free;
+		c->free = id;
+		return -1;
+	}
+
+	Digram d = *digram;
+	digram_normalize(&d);
+
+	bool found;
+	size_t i = digram_count_find(c, &d, &found);
+	c->slots[i] = id + 1;
+	c->size++;
+	return 0;
+}
+
+static void digram_count_remove(DigramCount* c, const Digram* digram) {
+	Digram d = *digram;
+	digram_normalize(&d);
+
+	size_t id = digram_count_get(c, &d);
+	if(id != DIGRAM_COUNT_NONE)
+		digram_count_remove_id(c, id);
+}
+
+// delta is signed to allow negative values
+static int update_digram_count_delta(DigramCount* digram_count, const Digram* digram, int64_t delta) {
+	Digram d = *digram;
+	digram_normalize(&d);
+
+	size_t id = digram_count_get(digram_count, &d);
+	if(id != DIGRAM_COUNT_NONE) {
+		DigramCountEntry* e = digram_count->entries + id;
+
+		e->count += delta;
+		if(e->count <= 0) {
+			// the rest of the decrement belongs to the records of the digram
+			if(e->count < 0 && digram_count->spill.len > 0 && digram_spill_write(&digram_count->spill, &d, e->count) < 0)
 				return -1;
+			digram_count_remove_id(digram_count, id);
 		}
+		else if(e->count > e->queued_count) {
+			e->queued_count = e->count;
+			pqueue_update(&digram_count->queue, id);
+		}
+	}
+	else if(delta > 0) {
+		// a new digram keeps the orientation in which it was found, the replacements depend on it
+		if(digram_count_add(digram_count, digram, delta) < 0)
+			return -1;
+	}
+	else if(delta < 0 && digram_count->spill.len > 0) {
+		// the digram may be spilled
+		if(digram_spill_write(&digram_count->spill, &d, delta) < 0)
+			return -1;
 	}
 
 	return 0;
 }
 
+// Aggregates the records of each bucket, so each spilled digram has at most one record afterwards.
+// Digrams whose frequency is not positive anymore are removed. If `h` is not NULL,
+// the frequencies of the records are added to the histogram.
+static int digram_spill_aggregate(DigramSpill* s, CountHistogram* h) {
+	int res = -1;
+
+	DigramSpillRecord* block = malloc(DIGRAM_SPILL_BLOCK * sizeof(*block));
+	if(!block)
+		return -1;
+
+	DigramDeltaMap m;
+	digram_delta_map_init(&m);
+
+	s->len = 0;
+	s->max_count = 0;
+	for(size_t b = 0; b < DIGRAM_SPILL_BUCKETS; b++) {
+		FILE* f = digram_spill_take(s, b);
+		if(!f)
+			continue;
+
+		size_t n;
+		while((n = fread(block, sizeof(*block), DIGRAM_SPILL_BLOCK, f)) > 0) {
+			for(size_t i = 0; i < n; i++) {
+				int64_t* count = digram_delta_map_put(&m, &block[i].digram, NULL);
+				if(!count) {
+					fclose(f);
+					goto exit;
+				}
+				*count += block[i].count;
+			}
+		}
+
+		if(digram_spill_release(s, f) < 0)
+			goto exit;
+
+		size_t pos = 0;
+		DigramDeltaMapEntry* e;
+		while((e = digram_delta_map_next(&m, &pos)) != NULL) {
+			if(e->val <= 0)
+				continue;
+			if(digram_spill_write(s, &e->key, e->val) < 0 || (h && count_histogram_add(h, e->val) < 0))
+				goto exit;
+		}
+		digram_delta_map_clear(&m);
+	}
+
+	s->aggregated_len = s->len;
+	res = 0;
+
+exit:
+	digram_delta_map_destroy(&m);
+	free(block);
+	return res;
+}
+
+// The records are aggregated if there are too many, mostly because of spilled decrements.
+// Each aggregation reads all records, so they may grow to several times the aggregated records before.
+static inline int digram_count_ensure_limit(DigramCount* c) {
+	if(c->max_len > 0 && c->spill.len > 4 * c->spill.aggregated_len + c->max_len)
+		return digram_spill_aggregate(&c->spill, NULL);
+	return 0;
+}
+
+// Loads the most frequent spilled digrams into memory, as many as fit into the free space of the counter.
+static int digram_count_reload(DigramCount* c) {
+	int res = -1;
+	DigramSpill* s = &c->spill;
+
+	// The less frequent digrams in memory are spilled as well,
+	// so their frequencies are aggregated with their records.
+	if(c->size > c->max_len / 2 && digram_count_spill(c) < 0)
+		return -1;
+
+	CountHistogram h;
+	count_histogram_init(&h);
+	CountHistogramEntry* counts = NULL;
+
+	DigramSpillRecord* block = malloc(DIGRAM_SPILL_BLOCK * sizeof(*block));
+	if(!block)
+		goto exit;
+
+	if(digram_spill_aggregate(s, &h) < 0)
+		goto exit;
+
+	size_t len = count_histogram_size(&h);
+	if(len == 0) {
+		res = 0;
+		goto exit;
+	}
+	if(!(counts = count_histogram_sorted(&h)))
+		goto exit;
+
+	// The digrams with a frequency of at least `threshold` are loaded, of the next lower frequency
+	// only as many digrams as fit. At least one digram is loaded, even if the counter is full.
+	size_t room = c->max_len > c->size ? c->max_len - c->size : 0;
+	size_t i = len, loaded = 0;
+	while(i > 0 && loaded + counts[i - 1].val <= room)
+		loaded += counts[--i].val;
+
+	uint64_t threshold = i < len ? counts[i].key : counts[len - 1].key + 1;
+	uint64_t partial_count = i > 0 ? counts[i - 1].key : 0;
+	size_t partial = i == len && room == 0 ? 1 : room - loaded;
+
+	s->len = 0;
+	s->max_count = 0;
+	for(size_t b = 0; b < DIGRAM_SPILL_BUCKETS; b++) {
+		FILE* f = digram_spill_take(s, b);
+		if(!f)
+			continue;
+
+		size_t n;
+		while((n = fread(block, sizeof(*block), DIGRAM_SPILL_BLOCK, f)) > 0) {
+			for(i = 0; i < n; i++) {
+				const DigramSpillRecord* r = block + i;
+
+				int r_res;
+				if((uint64_t) r->count >= threshold)
+					r_res = update_digram_count_delta(c, &r->digram, r->count);
+				else if((uint64_t) r->count == partial_count && partial > 0) {
+					r_res = update_digram_count_delta(c, &r->digram, r->count);
+					partial--;
+				}
+				else
+					r_res = digram_spill_write(s, &r->digram, r->count);
+
+				if(r_res < 0) {
+					fclose(f);
+					goto exit;
+				}
+			}
+		}
+
+		if(digram_spill_release(s, f) < 0)
+			goto exit;
+	}
+
+	s->aggregated_len = s->len;
+	res = 0;
+
+exit:
+	if(counts)
+		free(counts);
+	if(block)
+		free(block);
+	count_histogram_destroy(&h);
+	return res;
+}
+
+// Number of digrams the counter can keep in memory with the given number of bytes.
+// The capacity of the table of the ids is doubled if it is exceeded, so the limit is
+// slightly lower than the maximum number of digrams of the largest capacity that fits.
+static size_t digram_count_max_len(size_t bytes) {
+	size_t len = DIGRAM_COUNT_DEFAULT_CAPACITY / 2;
+	for(size_t cap = DIGRAM_COUNT_DEFAULT_CAPACITY; ; cap *= 2) {
+		size_t l = cap * 3 / 4;
+		// the entries, the queue and the positions in the queue grow by 50 %
+		size_t size = cap * sizeof(uint32_t) + l * (sizeof(DigramCountEntry) + 2 * sizeof(size_t)) * 3 / 2;
+		if(size > bytes)
+			break;
+		len = l - l / 8;
+	}
+	return len;
+}
+
+// Number of nodes a thread takes at once when counting the digrams
+#define REPAIR_COUNT_CHUNK 1024
+
+typedef struct {
+	NodeAdjacencyDict* dict;
+	atomic_size_t* next; // first node of the next chunk that is not processed yet
+	DigramDeltaMap counts; // frequencies of the normalized digrams found by this thread
+	size_t max_len; // maximum number of digrams in `counts`, 0 for no limit
+	DigramSpill* spill;
+	int res;
+} DigramCountWorker;
+
+static int add_digram_count_delta(DigramDeltaMap* counts, const Digram* digram, int64_t delta) {
+	if(delta == 0)
+		return 0;
+
+	Digram d = *digram;
+	digram_normalize(&d);
+
+	int64_t* count = digram_delta_map_put(counts, &d, NULL);
+	if(!count)
+		return -1;
+
+	*count += delta;
+	return 0;
+}
+
 // In this function, we do not check for the rank of the digram so we count all available digrams,
 // because this function is called before replacing the digrams.
 // So all found digrams have a rank of 3.
-static Hashmap* repair_count_digrams(NodeAdjacencyDict* dict) {
-	Hashmap* digram_count = hashmap_init(cmp_digram_type_cb, hash_digram_type_cb);
-	if(!digram_count)
-		return NULL;
+static int repair_count_digrams_of_nodes(DigramCountWorker* w) {
+	NodeAdjacencyDict* dict = w->dict;
+
+	Digram digram;
+	size_t delta;
 
-	// declaring all variables used in the loop
-	Hashmap* adj_type_dict;
-	size_t adjacency_type_count;
+	size_t from;
+	while((from = atomic_fetch_add(w->next, REPAIR_COUNT_CHUNK)) < dict->nodes) {
+		size_t to = MIN(from + REPAIR_COUNT_CHUNK, dict->nodes);
 
-	AdjacencyType **tmp, **keys = NULL;
-	size_t keys_cap = 0;
+		for(size_t node = from; node < to; node++) {
+			const NodeAdjacency* n = dict->dict + node;
 
-	HashmapIterator it;
-	const AdjacencyType* adj_tmp;
+			for(uint32_t i = 0; i < n->len; i++) {
+				const AdjacencyCount* count_i = n->data + i;
 
-	uint64_t *count_i, *count_j;
-	Digram digram;
-	size_t delta;
+				digram.adj0 = count_i->adj;
 
-	for(size_t node = 0; node < dict->nodes; node++) {
-		if((adj_type_dict = dict->dict[node]) == NULL)
-			continue; // no entry for this node
+				for(uint32_t j = i + 1; j < n->len; j++) {
+					const AdjacencyCount* count_j = n->data + j;
 
-		adjacency_type_count = hashmap_size(adj_type_dict);
+					digram.adj1 = count_j->adj;
 
-		// create the list of keys
-		if(adjacency_type_count > keys_cap) {
-			// only realloc if the capacity does not match, and reuse the list of keys
-			// this may lead to more memory usage but increases the performance
-			// despite causing more cache misses
+					delta = count_i->count < count_j->count ? count_i->count : count_j->count;
 
-			tmp = realloc(keys, adjacency_type_count * sizeof(AdjacencyType*));
-			if(!tmp)
-				goto err;
+					if(add_digram_count_delta(&w->counts, &digram, delta) < 0)
+						return -1;
+				}
+
+				digram.adj1 = count_i->adj;
+				delta = count_i->count / 2;
 
-			keys = tmp;
-			keys_cap = adjacency_type_count;
+				if(add_digram_count_delta(&w->counts, &digram, delta) < 0)
+					return -1;
+			}
+
+			// The least frequent digrams are not known before all nodes are counted,
+			// so all digrams of the thread are spilled.
+			if(w->max_len > 0 && digram_delta_map_size(&w->counts) > w->max_len && digram_spill_write_map(w->spill, &w->counts) < 0)
+				return -1;
 		}
+	}
 
-		hashmap_iter(adj_type_dict, &it);
+	return 0;
+}
 
-		size_t i = 0;
-		while((adj_tmp = hashmap_iter_next_key(&it, NULL)) != NULL)
-			keys[i++] = (AdjacencyType*) adj_tmp;
+static void* repair_count_digrams_worker(void* arg) {
+	DigramCountWorker* w = arg;
+	w->res = repair_count_digrams_of_nodes(w);
+	return NULL;
+}
 
-		for(i = 0; i < adjacency_type_count; i++) {
-			if(!(count_i = hashmap_get(adj_type_dict, keys[i], sizeof(AdjacencyType), NULL)))
-				goto err;
+// The nodes are processed in chunks by all threads. Each thread counts the digrams in its own map,
+// afterwards the maps are merged. Because only the frequencies are summed up, the resulting
+// counts are the same as counting all digrams by a single thread.
+//
+// If the maps of the threads exceed their share of `max_len`, they are spilled. In this case, all frequencies
+// are aggregated on the disk and the most frequent digrams are loaded into the counter afterwards.
+static int repair_count_digrams(NodeAdjacencyDict* dict, int threads, size_t max_len, DigramCount* digram_count) {
+	if(threads < 1)
+		threads = 1;
+
+	if(digram_count_init(digram_count, max_len) < 0)
+		return -1;
 
-			digram.adj0 = *keys[i];
+	DigramCountWorker* workers = calloc(threads, sizeof(*workers));
+	if(!workers)
+		goto err0;
 
-			for(size_t j = i + 1; j < adjacency_type_count; j++) {
-				if(!(count_j = hashmap_get(adj_type_dict, keys[j], sizeof(AdjacencyType), NULL)))
-					goto err;
+	atomic_size_t next;
+	atomic_init(&next, 0);
 
-				digram.adj1 = *keys[j];
+	int i;
+	for(i = 0; i < threads; i++) {
+		workers[i].dict = dict;
+		workers[i].next = &next;
+		digram_delta_map_init(&workers[i].counts);
+		workers[i].max_len = max_len > 0 ? MAX(max_len / threads, 1) : 0;
+		workers[i].spill = &digram_count->spill;
+	}
 
-				delta = *count_i < *count_j ? *count_i : *count_j;
+	repair_run_parallel(threads, repair_count_digrams_worker, workers, sizeof(*workers));
 
-				if(update_digram_count_delta(digram_count, &digram, delta) < 0)
-					goto err;
-			}
+	for(i = 0; i < threads; i++)
+		if(workers[i].res < 0)
+			goto err1;
 
-			digram.adj1 = *keys[i];
-			delta = *count_i / 2;
+	if(digram_count->spill.len > 0) {
+		for(i = 0; i < threads; i++)
+			if(digram_spill_write_map(&digram_count->spill, &workers[i].counts) < 0)
+				goto err1;
+		if(digram_count_reload(digram_count) < 0)
+			goto err1;
+	}
+	else {
+		for(i = 0; i < threads; i++) {
+			size_t pos = 0;
+			DigramDeltaMapEntry* e;
 
-			if(update_digram_count_delta(digram_count, &digram, delta) < 0)
-				goto err;
+			while((e = digram_delta_map_next(&workers[i].counts, &pos)) != NULL) {
+				if(update_digram_count_delta(digram_count, &e->key, e->val) < 0)
+					goto err1;
+			}
 		}
 	}
 
-	free(keys);
+	for(i = 0; i < threads; i++)
+		digram_delta_map_destroy(&workers[i].counts);
+	free(workers);
 
-	return digram_count;
+	return 0;
 
-err:
-	if(keys)
-		free(keys);
-	hashmap_destroy(digram_count);
-	return NULL;
+err1:
+	for(i = 0; i < threads; i++)
+		digram_delta_map_destroy(&workers[i].counts);
+	free(workers);
+err0:
+	digram_count_destroy(digram_count);
+	return -1;
 }
 
 static inline bool should_continue_replacing_digram(SLHRGrammar* grammar, const Digram* digram, uint64_t n) {
@@ -301,91 +1258,157 @@ static inline bool should_continue_replacing_digram(SLHRGrammar* grammar, const
 	return n * m + g < n * g;
 }
 
-static bool repair_digram_to_replace(SLHRGrammar* g, Hashmap* digram_count, Digram* digram) {
-	HashmapIterator it;
-	hashmap_iter(digram_count, &it);
-	MapItem item;
+// Returns the entry of the most frequent digram or NULL if there are no digrams.
+static const DigramCountEntry* digram_count_peek(DigramCount* c) {
+	while(!pqueue_empty(&c->queue)) {
+		size_t id = pqueue_peek(&c->queue);
+		DigramCountEntry* e = c->entries + id;
 
-	const Digram* res = NULL;
-	uint64_t res_count = 0, item_count;
+		// The frequencies of the other entries are at most their queued frequencies,
+		// so the head is the most frequent digram if its queued frequency is up to date.
+		if(e->queued_count == e->count)
+			return e;
 
-	while(hashmap_iter_next(&it, &item)) {
-		item_count = *((uint64_t*) item.val);
+		e->queued_count = e->count;
+		pqueue_update(&c->queue, id);
+	}
+
+	return NULL;
+}
 
-		if(!res || item_count > res_count) {
-			res = item.key;
-			res_count = item_count;
+// Returns 1 if a digram should be replaced, 0 if the replacement is finished and -1 on errors.
+static int repair_digram_to_replace(SLHRGrammar* g, DigramCount* digram_count, Digram* digram) {
+	const DigramCountEntry* res = digram_count_peek(digram_count);
+	const DigramSpill* s = &digram_count->spill;
+
+	// A spilled digram may be more frequent than the digrams in memory. Because a reload reads all records,
+	// the digrams are not reloaded as soon as the head drops below the highest spilled frequency,
+	// but only if the difference exceeds a margin or if the replacement would end otherwise.
+	if(s->len > 0 && (!res || res->count < s->max_count)) {
+		int64_t margin = MAX(s->max_count / DIGRAM_SPILL_RELOAD_MARGIN, 1);
+		if(!res || res->count < s->max_count - margin || !should_continue_replacing_digram(g, &res->digram, res->count)) {
+			if(digram_count_reload(digram_count) < 0)
+				return -1;
+			res = digram_count_peek(digram_count);
 		}
 	}
 
-	if(res == NULL || !should_continue_replacing_digram(g, res, res_count))
-		return false;
+	if(!res)
+		return 0;
 
-	*digram = *res;
-	return true;
+	if(!should_continue_replacing_digram(g, &res->digram, res->count))
+		return 0;
+
+	*digram = res->digram;
+	return 1;
+}
+
+// Number of digrams that are looked at per digram of a batch, before the batch is closed
+#define REPAIR_BATCH_SCAN 4
+
+static inline bool digram_shares_label(const Digram* d1, const Digram* d2) {
+	return d1->adj0.label == d2->adj0.label || d1->adj0.label == d2->adj1.label
+		|| d1->adj1.label == d2->adj0.label || d1->adj1.label == d2->adj1.label;
+}
+
+// Determines up to `k` digrams which are replaced in one round. The first one is the most frequent digram,
+// the others are the next frequent digrams that do not share a label with a digram of the batch.
+// So the occurrences of the digrams are disjoint and replacing one digram does not change the frequency
+// of the others. `scanned` must have space for `k * REPAIR_BATCH_SCAN` ids.
+// Returns 1 if digrams should be replaced, 0 if the replacement is finished and -1 on errors.
+static int repair_digrams_to_replace(SLHRGrammar* g, DigramCount* digram_count, size_t k, Digram* batch, size_t* len, size_t* scanned) {
+	int res = repair_digram_to_replace(g, digram_count, &batch[0]);
+	if(res != 1)
+		return res;
+
+	*len = 1;
+	if(k == 1)
+		return 1;
+
+	// The looked at digrams are removed from the queue, so the next frequent one is at its head.
+	size_t scanned_len = 0;
+	const DigramCountEntry* e = digram_count_peek(digram_count);
+	pqueue_remove(&digram_count->queue, e - digram_count->entries);
+	scanned[scanned_len++] = e - digram_count->entries;
+
+	while(*len < k && scanned_len < k * REPAIR_BATCH_SCAN && (e = digram_count_peek(digram_count))) {
+		// a spilled digram may be more frequent, so the batch is closed
+		if(digram_count->spill.len > 0 && e->count < digram_count->spill.max_count)
+			break;
+		if(!should_continue_replacing_digram(g, &e->digram, e->count))
+			break;
+
+		pqueue_remove(&digram_count->queue, e - digram_count->entries);
+		scanned[scanned_len++] = e - digram_count->entries;
+
+		size_t i;
+		for(i = 0; i < *len && !digram_shares_label(&e->digram, &batch[i]); i++);
+		if(i == *len)
+			batch[(*len)++] = e->digram;
+	}
+
+	// the queued frequencies of the removed entries are up to date, because they were at the head
+	for(size_t i = 0; i < scanned_len; i++)
+		if(pqueue_push(&digram_count->queue, scanned[i]) < 0)
+			return -1;
+
+	return 1;
 }
 
+typedef struct {
+	size_t len;
+	size_t cap;
+	size_t* data;
+} OccStateList;
+
+FLATMAP_DEFINE(OccStateAdjMap, occ_state_adj_map, AdjacencyType, OccStateList, hash_adjacency_type, eq_adjacency_type)
+
 typedef struct {
 	bool is_map; // either a dict or just an edge
 	union {
-		Hashmap* map;
+		OccStateAdjMap map;
 		size_t edge;
 	};
 } OccStateElement;
 
+FLATMAP_DEFINE(OccStateMap, occ_state_map, uint64_t, OccStateElement, hash_uint, eq_uint)
+
 typedef struct {
 	size_t start;
-	Hashmap* map;
+	OccStateMap map;
 } OccState;
 
-typedef struct {
-	size_t len;
-	size_t cap;
-	size_t* data;
-} OccStateList;
-
 static int occ_state_init(OccState* s) {
-	Hashmap* m = hashmap_init(cmp_uint_cb, hash_uint_cb);
-	if(!m)
-		return -1;
-
 	s->start = 0;
-	s->map = m;
+	occ_state_map_init(&s->map);
 	return 0;
 }
 
-static void occ_state_destroy_items(Hashmap* m) {
-	HashmapIterator it;
-	hashmap_iter(m, &it);
-	MapItem item;
+static void occ_state_destroy_items(OccStateAdjMap* m) {
+	size_t pos = 0;
+	OccStateAdjMapEntry* e;
 
-	while(hashmap_iter_next(&it, &item)) {
-		OccStateList* l = item.val;
-		if(l->data)
-			free(l->data);
+	while((e = occ_state_adj_map_next(m, &pos)) != NULL) {
+		if(e->val.data)
+			free(e->val.data);
 	}
+	occ_state_adj_map_destroy(m);
 }
 
 static void occ_state_destroy(OccState* s) {
-	HashmapIterator it;
-	hashmap_iter(s->map, &it);
-	MapItem item;
+	size_t pos = 0;
+	OccStateMapEntry* e;
 
-	while(hashmap_iter_next(&it, &item)) {
-		OccStateElement* e = item.val;
-
-		if(e->is_map) {
-			Hashmap* m = e->map;
-			occ_state_destroy_items(m);
-			hashmap_destroy(m);
-		}
+	while((e = occ_state_map_next(&s->map, &pos)) != NULL) {
+		if(e->val.is_map)
+			occ_state_destroy_items(&e->val.map);
 	}
 
-	hashmap_destroy(s->map);
+	occ_state_map_destroy(&s->map);
 }
 
 static bool occ_state_contains_node(OccState* s, uint64_t node) {
-	return hashmap_contains_key(s->map, &node, sizeof(node));
+	return occ_state_map_get(&s->map, &node) != NULL;
 }
 
 static int occ_state_list_init(OccStateList* l, size_t i) {
@@ -402,55 +1425,45 @@ static int occ_state_list_init(OccStateList* l, size_t i) {
 }
 
 static int occ_state_node_adj_init(OccState* s, uint64_t node, const AdjacencyType* adj, size_t i) {
-	Hashmap* m = hashmap_init(cmp_adjacency_type_cb, hash_adjacency_type_cb);
-	if(!m)
+	OccStateElement* e = occ_state_map_put(&s->map, &node, NULL);
+	if(!e)
 		return -1;
 
-	OccStateList l;
-	if(occ_state_list_init(&l, i) < 0)
-		goto err0;
-
-	if(hashmap_put(m, adj, sizeof(*adj), &l, sizeof(l)) < 0)
-		goto err1;
-
-	OccStateElement e;
-	e.is_map = true;
-	e.map = m;
+	e->is_map = true;
+	occ_state_adj_map_init(&e->map);
 
-	if(hashmap_put(s->map, &node, sizeof(node), &e, sizeof(e)) < 0)
-		goto err1;
+	OccStateList* l = occ_state_adj_map_put(&e->map, adj, NULL);
+	if(!l || occ_state_list_init(l, i) < 0) {
+		occ_state_adj_map_destroy(&e->map);
+		occ_state_map_remove(&s->map, &node);
+		return -1;
+	}
 
 	return 0;
-
-err1:
-	free(l.data);
-err0:
-	hashmap_destroy(m);
-	return -1;
 }
 
 // node must exist in state as a adj map!
 static bool occ_state_node_contains_adj(OccState* s, uint64_t node, const AdjacencyType* adj) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
 	assert(e != NULL);
 
-	return hashmap_contains_key(e->map, adj, sizeof(*adj));
+	return occ_state_adj_map_get(&e->map, adj) != NULL;
 }
 
 // node must exist in state as a adj map!
 static size_t occ_state_node_len(OccState* s, uint64_t node) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
 	assert(e != NULL);
 
-	return hashmap_size(e->map);
+	return occ_state_adj_map_size(&e->map);
 }
 
 // node, adj must exist in state as a adj map!
 static inline OccStateList* _occ_state_node_list(OccState* s, uint64_t node, const AdjacencyType* adj) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
 	assert(e != NULL);
 
-	return hashmap_get(e->map, adj, sizeof(*adj), NULL);
+	return occ_state_adj_map_get(&e->map, adj);
 }
 
 static int occ_state_list_ensure_cap(OccStateList* l, size_t cap) {
@@ -493,14 +1506,14 @@ static bool occ_state_node_adj_matches_i(OccState* s, uint64_t node, const Adjac
 
 // node must exist in state but adj must not exist in map of the node!
 static int occ_state_node_adj_set_i(OccState* s, uint64_t node, const AdjacencyType* adj, size_t i) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
 
-	OccStateList l;
-	if(occ_state_list_init(&l, i) < 0)
+	OccStateList* l = occ_state_adj_map_put(&e->map, adj, NULL);
+	if(!l)
 		return -1;
 
-	if(hashmap_put(e->map, adj, sizeof(*adj), &l, sizeof(l)) < 0) {
-		free(l.data);
+	if(occ_state_list_init(l, i) < 0) {
+		occ_state_adj_map_remove(&e->map, adj);
 		return -1;
 	}
 
@@ -547,47 +1560,346 @@ static size_t occ_state_node_adj_len(OccState* s, uint64_t node, const Adjacency
 
 // node, adj must exist in state as a adj map!
 static void occ_state_node_adj_del(OccState* s, uint64_t node, const AdjacencyType* adj) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
-	Hashmap* m = e->map;
-	OccStateList* l = hashmap_get(m, adj, sizeof(*adj), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
+	OccStateList* l = occ_state_adj_map_get(&e->map, adj);
 
 	if(l->data)
 		free(l->data);
 
-	hashmap_remove(m, adj, sizeof(*adj));
+	occ_state_adj_map_remove(&e->map, adj);
 }
 
 // node must exist in state as a adj map!
 static void occ_state_node_del(OccState* s, uint64_t node) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
-	if(e->is_map) {
-		occ_state_destroy_items(e->map);
-		hashmap_destroy(e->map);
-	}
-	hashmap_remove(s->map, &node, sizeof(node));
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
+	if(e->is_map)
+		occ_state_destroy_items(&e->map);
+	occ_state_map_remove(&s->map, &node);
 }
 
 // node must exist in state!
 static int occ_state_node_init_edge(OccState* s, uint64_t node, size_t edge) {
-	OccStateElement e;
-	e.is_map = false;
-	e.edge = edge;
-
-	if(hashmap_put(s->map, &node, sizeof(node), &e, sizeof(e)) != 0) // element must not exist
+	bool added;
+	OccStateElement* e = occ_state_map_put(&s->map, &node, &added);
+	if(!e || !added) // element must not exist
 		return -1;
 
+	e->is_map = false;
+	e->edge = edge;
 	return 0;
 }
 
 // node must exist in state as an edge!
 static size_t occ_state_node_edge_get(OccState* s, uint64_t node) {
-	OccStateElement* e = hashmap_get(s->map, &node, sizeof(node), NULL);
+	OccStateElement* e = occ_state_map_get(&s->map, &node);
 	return e->edge;
 }
 
-static int find_occurrence_of_digram(const Digram* digram_to_replace, HGraph* start_rule, OccState* state, size_t res[2]) {
-	size_t len = hgraph_len(start_rule);
-	for(size_t i = state->start; i < len; i++) {
+static int cmp_size_t_cb(const void* v1, const void* v2) {
+	const size_t* n1 = v1;
+	const size_t* n2 = v2;
+	return CMP(*n1, *n2);
+}
+
+// Edge at a node
+typedef struct {
+	uint64_t node;
+	size_t edge;
+} NodeEdge;
+
+typedef struct {
+	size_t len;
+	size_t cap;
+	NodeEdge* data;
+} NodeEdgeList;
+
+FLATMAP_DEFINE(AdjacencyEdgeMap, adjacency_edge_map, AdjacencyType, NodeEdgeList, hash_adjacency_type, eq_adjacency_type)
+
+// The edges of each adjacency type in the start rule with the nodes at which they have the adjacency type.
+// Each list is sorted by the nodes, so the edges of an adjacency type at a node are consecutive.
+// An occurrence of a digram lies at a node that has both adjacency types of the digram,
+// so the edges that may be part of an occurrence are found by walking through the nodes of the shorter list
+// and looking up these nodes in the other list.
+// The lists of a new label are filled while the edges are created and sorted afterwards.
+// Replaced edges are removed when the list is walked through the next time. Because long lists are often only searched,
+// all lists are cleaned as soon as they contain more replaced edges than incidences of the edges in the start rule.
+typedef struct {
+	AdjacencyEdgeMap map;
+	size_t len; // number of edges in all lists
+	size_t incidences; // number of incidences of the edges in the start rule
+} OccurrenceDict;
+
+static void occurrence_dict_destroy(OccurrenceDict* dict) {
+	size_t pos = 0;
+	AdjacencyEdgeMapEntry* e;
+
+	while((e = adjacency_edge_map_next(&dict->map, &pos)) != NULL) {
+		if(e->val.data)
+			free(e->val.data);
+	}
+	adjacency_edge_map_destroy(&dict->map);
+}
+
+static int cmp_node_edge_cb(const void* v1, const void* v2) {
+	const NodeEdge* e1 = v1;
+	const NodeEdge* e2 = v2;
+
+	if(e1->node != e2->node)
+		return CMP(e1->node, e2->node);
+	return CMP(e1->edge, e2->edge);
+}
+
+static void occurrence_dict_sort(OccurrenceDict* dict, uint64_t label, int rank) {
+	AdjacencyType adj = {label, 0};
+	for(; adj.conn_type < (size_t) rank; adj.conn_type++) {
+		NodeEdgeList* l = adjacency_edge_map_get(&dict->map, &adj);
+		if(l)
+			qsort(l->data, l->len, sizeof(*l->data), cmp_node_edge_cb);
+	}
+}
+
+static int occurrence_dict_init(OccurrenceDict* dict, HGraph* start_rule) {
+	adjacency_edge_map_init(&dict->map);
+	dict->len = 0;
+	dict->incidences = 0;
+
+	// The lists are allocated with their exact size, so the edges are read twice.
+	AdjacencyType adj;
+	size_t i, len = hgraph_len(start_rule);
+	for(i = 0; i < len; i++) {
+		HEdge* edge = hgraph_edge_get(start_rule, i);
+		if(!edge)
+			continue;
+
+		adj.label = edge->label;
+		for(adj.conn_type = 0; adj.conn_type < edge->rank; adj.conn_type++) {
+			NodeEdgeList* l = adjacency_edge_map_put(&dict->map, &adj, NULL);
+			if(!l)
+				goto err;
+			l->cap++;
+		}
+		dict->len += edge->rank;
+	}
+
+	size_t pos = 0;
+	AdjacencyEdgeMapEntry* e;
+	while((e = adjacency_edge_map_next(&dict->map, &pos)) != NULL) {
+		if(!(e->val.data = malloc(e->val.cap * sizeof(*e->val.data))))
+			goto err;
+	}
+
+	for(i = 0; i < len; i++) {
+		HEdge* edge = hgraph_edge_get(start_rule, i);
+		if(!edge)
+			continue;
+
+		adj.label = edge->label;
+		for(adj.conn_type = 0; adj.conn_type < edge->rank; adj.conn_type++) {
+			NodeEdgeList* l = adjacency_edge_map_get(&dict->map, &adj);
+			l->data[l->len].node = edge->nodes[adj.conn_type];
+			l->data[l->len].edge = i;
+			l->len++;
+		}
+	}
+
+	pos = 0;
+	while((e = adjacency_edge_map_next(&dict->map, &pos)) != NULL)
+		qsort(e->val.data, e->val.len, sizeof(*e->val.data), cmp_node_edge_cb);
+
+	dict->incidences = dict->len;
+	return 0;
+
+err:
+	occurrence_dict_destroy(dict);
+	return -1;
+}
+
+// The index of a replaced edge is only reused by an edge with a new label, so an edge in the list
+// that does not have the adjacency type at the node anymore will not have it again.
+static inline bool occurrence_dict_valid(HGraph* start_rule, const AdjacencyType* adj, const NodeEdge* e) {
+	HEdge* edge = hgraph_edge_get(start_rule, e->edge);
+	return edge && edge->label == adj->label && edge->nodes[adj->conn_type] == e->node;
+}
+
+// Removes the replaced edges from all lists.
+static void occurrence_dict_clean(OccurrenceDict* dict, HGraph* start_rule) {
+	size_t pos = 0;
+	AdjacencyEdgeMapEntry* e;
+
+	dict->len = 0;
+	while((e = adjacency_edge_map_next(&dict->map, &pos)) != NULL) {
+		NodeEdgeList* l = &e->val;
+
+		size_t len = 0;
+		for(size_t i = 0; i < l->len; i++)
+			if(occurrence_dict_valid(start_rule, &e->key, l->data + i))
+				l->data[len++] = l->data[i];
+		l->len = len;
+		dict->len += len;
+
+		if(len == 0) {
+			free(l->data);
+			l->data = NULL;
+			l->cap = 0;
+		}
+		else if(len < l->cap) {
+			NodeEdge* tmp = realloc(l->data, len * sizeof(*tmp));
+			if(tmp) {
+				l->cap = len;
+				l->data = tmp;
+			}
+		}
+	}
+}
+
+// Adds the new edge with the index `edge`, that replaced edges with `removed` incidences.
+// The lists of its label have to be sorted with `occurrence_dict_sort` after all edges with the label are added.
+static int occurrence_dict_add(OccurrenceDict* dict, HGraph* start_rule, const HEdge* new_edge, size_t edge, size_t removed) {
+	AdjacencyType adj;
+	adj.label = new_edge->label;
+
+	for(adj.conn_type = 0; adj.conn_type < new_edge->rank; adj.conn_type++) {
+		NodeEdgeList* l = adjacency_edge_map_put(&dict->map, &adj, NULL);
+		if(!l)
+			return -1;
+
+		if(l->len == l->cap) {
+			size_t cap = l->cap < 8 ? 8 : (l->cap + (l->cap >> 1));
+			NodeEdge* tmp = realloc(l->data, cap * sizeof(*tmp));
+			if(!tmp)
+				return -1;
+
+			l->cap = cap;
+			l->data = tmp;
+		}
+
+		l->data[l->len].node = new_edge->nodes[adj.conn_type];
+		l->data[l->len].edge = edge;
+		l->len++;
+	}
+	dict->len += new_edge->rank;
+	dict->incidences = dict->incidences + new_edge->rank - removed;
+
+	if(dict->len > 2 * dict->incidences)
+		occurrence_dict_clean(dict, start_rule);
+
+	return 0;
+}
+
+// Moves the edges of the list from position `*src` on with a node less than `node` (or equal to `node` if `inclusive` is set)
+// to position `*dst` on and removes the replaced edges. If `res` is not NULL, the moved edges are also appended to `res`.
+static int occurrence_dict_walk(HGraph* start_rule, NodeEdgeList* l, const AdjacencyType* adj, uint64_t node, bool inclusive, size_t* src, size_t* dst, OccStateList* res) {
+	for(; *src < l->len && (l->data[*src].node < node || (inclusive && l->data[*src].node == node)); (*src)++) {
+		if(!occurrence_dict_valid(start_rule, adj, l->data + *src))
+			continue;
+
+		l->data[(*dst)++] = l->data[*src];
+		if(res && occ_state_list_append(res, l->data[*src].edge) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+// Appends the edges of the adjacency type at the node to `dst`.
+static int occurrence_dict_search(HGraph* start_rule, const NodeEdgeList* l, const AdjacencyType* adj, uint64_t node, OccStateList* dst) {
+	// binary search for the first edge at the node
+	size_t from = 0, to = l->len;
+	while(from < to) {
+		size_t mid = from + (to - from) / 2;
+		if(l->data[mid].node < node)
+			from = mid + 1;
+		else
+			to = mid;
+	}
+
+	for(; from < l->len && l->data[from].node == node; from++) {
+		if(occurrence_dict_valid(start_rule, adj, l->data + from) && occ_state_list_append(dst, l->data[from].edge) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+// Determines the sorted list of the indices of all edges in the start rule that may be part of an occurrence of the digram.
+// These are the edges with an adjacency type of the digram at a node that has both adjacency types
+// (or the adjacency type at least twice, if both are equal).
+// The shorter of the lists of both adjacency types is walked through. The nodes are either searched in the other list
+// or, if this is not faster, the other list is walked through as well. So the costs are O(min(n_1 + n_2, n_1 log n_2))
+// for the lengths n_1 <= n_2 of the lists, instead of the number of all edges with the labels of the digram.
+static int occurrence_dict_candidates(OccurrenceDict* dict, HGraph* start_rule, NodeAdjacencyDict* adj_dict, const Digram* digram, OccStateList* dst) {
+	dst->len = 0;
+
+	NodeEdgeList* l0 = adjacency_edge_map_get(&dict->map, &digram->adj0);
+	NodeEdgeList* l1 = adjacency_edge_map_get(&dict->map, &digram->adj1);
+	if(!l0 || !l1)
+		return 0;
+
+	bool first = l0->len <= l1->len;
+	NodeEdgeList* l = first ? l0 : l1;
+	NodeEdgeList* l_2 = first ? l1 : l0;
+	const AdjacencyType* adjacency_type = first ? &digram->adj0 : &digram->adj1;
+	const AdjacencyType* adjacency_type_2 = first ? &digram->adj1 : &digram->adj0;
+	bool equal = eq_adjacency_type(adjacency_type, adjacency_type_2);
+	bool search = equal || l->len * BIT_LEN(l_2->len) < l_2->len;
+
+	size_t src = 0, len = 0; // positions in the list of the first adjacency type
+	size_t src_2 = 0, len_2 = 0; // positions in the list of the second adjacency type, if it is walked through
+	while(src < l->len) {
+		uint64_t node = l->data[src].node;
+
+		size_t from = len;
+		if(occurrence_dict_walk(start_rule, l, adjacency_type, node, true, &src, &len, NULL) < 0)
+			return -1;
+		if(!search && occurrence_dict_walk(start_rule, l_2, adjacency_type_2, node, false, &src_2, &len_2, NULL) < 0)
+			return -1;
+
+		if(equal ? len - from < 2 : (len == from || !node_adjacency_get(adj_dict->dict + node, adjacency_type_2)))
+			continue;
+
+		if(occ_state_list_ensure_cap(dst, dst->len + len - from) < 0)
+			return -1;
+		for(size_t i = from; i < len; i++)
+			dst->data[dst->len++] = l->data[i].edge;
+
+		if(search) {
+			if(!equal && occurrence_dict_search(start_rule, l_2, adjacency_type_2, node, dst) < 0)
+				return -1;
+		}
+		else if(occurrence_dict_walk(start_rule, l_2, adjacency_type_2, node, true, &src_2, &len_2, dst) < 0)
+			return -1;
+	}
+	dict->len -= l->len - len;
+	l->len = len;
+
+	if(!search) {
+		if(occurrence_dict_walk(start_rule, l_2, adjacency_type_2, UINT64_MAX, true, &src_2, &len_2, NULL) < 0)
+			return -1;
+		dict->len -= l_2->len - len_2;
+		l_2->len = len_2;
+	}
+
+	// The edges of different nodes are not ordered and an edge is found twice,
+	// if it has both adjacency types of the digram.
+	qsort(dst->data, dst->len, sizeof(size_t), cmp_size_t_cb);
+
+	len = 0;
+	for(size_t i = 0; i < dst->len; i++)
+		if(len == 0 || dst->data[len - 1] != dst->data[i])
+			dst->data[len++] = dst->data[i];
+	dst->len = len;
+
+	return 0;
+}
+
+// The candidates are the sorted indices of the edges, that may be part of an occurrence
+// (see `occurrence_dict_candidates`). All other edges of the start rule can not be part of an occurrence,
+// so only the candidates needs to be checked instead of all edges of the start rule.
+// Because of this, `state->start` is the position in the list of candidates.
+static int find_occurrence_of_digram(const Digram* digram_to_replace, HGraph* start_rule, const OccStateList* candidates, OccState* state, size_t res[2]) {
+	size_t len = candidates->len;
+	for(size_t c = state->start; c < len; c++) {
+		size_t i = candidates->data[c];
 		HEdge* edge = hgraph_edge_get(start_rule, i);
 
 		// Because at the replacing of occurences of digramsthe, the removal of edges in the start rule
@@ -673,7 +1985,7 @@ static int find_occurrence_of_digram(const Digram* digram_to_replace, HGraph* st
 						if(occ_state_node_len(state, node) == 0)
 							occ_state_node_del(state, node);
 
-						state->start = i;
+						state->start = c;
 						// if j == 0 (i, edge_1) is returned;
 						// else (edge_1, i) is returned
 						res[j] = i;
@@ -697,7 +2009,7 @@ static int find_occurrence_of_digram(const Digram* digram_to_replace, HGraph* st
 					edge_1 = occ_state_node_edge_get(state, node);
 					occ_state_node_del(state, node);
 
-					state->start = i;
+					state->start = c;
 					res[0] = edge_1;
 					res[1] = i;
 					return 1;
@@ -715,17 +2027,12 @@ static inline bool digram_over_max_rank(const SLHRGrammar* g, int max_rank, cons
 
 // Because we only update the digram count for digrams, whose rank is less equal then the max rank,
 // the grammar and the max rank are also needed for this function.
-static int update_digram_count(const SLHRGrammar* g, int max_rank, HEdge* old_edges[2], HEdge* new_edge, NodeAdjacencyDict* node_adjacency_dict, Hashmap* digram_count) {
+static int update_digram_count(const SLHRGrammar* g, int max_rank, HEdge* old_edges[2], HEdge* new_edge, NodeAdjacencyDict* node_adjacency_dict, DigramCount* digram_count) {
 	// declaration of variables:
 	Digram digram;
 
-	uint64_t node;
-	Hashmap* adjacency_frequency_dir;
-
-	HashmapIterator it;
-	MapItem item;
-	const AdjacencyType* adjacency_type_2;
-	uint64_t count_2;
+	NodeAdjacency* n;
+	const AdjacencyCount* adjacency_type_2;
 
 	for(int i = 0; i < 2; i++) {
 		HEdge* edge = old_edges[i];
@@ -737,42 +2044,37 @@ static int update_digram_count(const SLHRGrammar* g, int max_rank, HEdge* old_ed
 		for(size_t connection_type = 0; connection_type < edge->rank; connection_type++) {
 			digram.adj0.conn_type = connection_type;
 
-			node = edge->nodes[connection_type];
-			adjacency_frequency_dir = node_adjacency_dict->dict[node];
-
-			uint64_t* count = hashmap_get(adjacency_frequency_dir, &digram.adj0, sizeof(digram.adj0), NULL);
-			assert(count != NULL);
-
-			hashmap_iter(adjacency_frequency_dir, &it);
+			n = node_adjacency_dict->dict + edge->nodes[connection_type];
 
-			while(hashmap_iter_next(&it, &item)) {
-				adjacency_type_2 = item.key;
+			AdjacencyCount* count = node_adjacency_get(n, &digram.adj0);
+			assert(count != NULL);
 
-				if(cmp_adjacency_type(&digram.adj0, adjacency_type_2) != 0) {
-					count_2 = *((uint64_t*) item.val);
+			for(uint32_t j = 0; j < n->len; j++) {
+				adjacency_type_2 = n->data + j;
 
-					if(*count <= count_2) {
-						digram.adj1 = *adjacency_type_2;
+				if(adjacency_type_2 != count && count->count <= adjacency_type_2->count) {
+					digram.adj1 = adjacency_type_2->adj;
 
-						// Do not check for the rank of the digram because this digram was replaced, so
-						// its rank does not exceeds the maximum rank.
-						update_digram_count_delta(digram_count, &digram, -1);
-					}
+					// Do not check for the rank of the digram because this digram was replaced, so
+					// its rank does not exceeds the maximum rank.
+					if(update_digram_count_delta(digram_count, &digram, -1) < 0)
+						return -1;
 				}
 			}
 
-			if(*count % 2 == 0) {
+			if(count->count % 2 == 0) {
 				digram.adj1 = digram.adj0;
 
 				// Do not check for the rank of the digram because this digram was replaced, so
 				// its rank does not exceeds the maximum rank.
-				update_digram_count_delta(digram_count, &digram, -1);
+				if(update_digram_count_delta(digram_count, &digram, -1) < 0)
+					return -1;
 			}
 
 			// Reduce the adjacency_type in the dict by 1.
-			(*count)--;
-			if(*count == 0)
-				hashmap_remove(adjacency_frequency_dir, &digram.adj0, sizeof(digram.adj0));
+			count->count--;
+			if(count->count == 0)
+				node_adjacency_remove(n, count);
 		}
 	}
 
@@ -784,143 +2086,220 @@ static int update_digram_count(const SLHRGrammar* g, int max_rank, HEdge* old_ed
 	for(size_t connection_type = 0; connection_type < new_edge->rank; connection_type++) {
 		digram.adj0.conn_type = connection_type;
 
-		node = new_edge->nodes[connection_type];
-		adjacency_frequency_dir = node_adjacency_dict->dict[node];
-
-		uint64_t count;
-		uint64_t* count_ptr = hashmap_get(adjacency_frequency_dir, &digram.adj0, sizeof(digram.adj0), NULL);
-		if(count_ptr == NULL) {
-			count = 1;
-			hashmap_put(adjacency_frequency_dir, &digram.adj0, sizeof(digram.adj0), &count, sizeof(count));
-		}
-		else
-			count = ++(*count_ptr); // preincrement
-
-		hashmap_iter(adjacency_frequency_dir, &it);
+		n = node_adjacency_dict->dict + new_edge->nodes[connection_type];
 
-		while(hashmap_iter_next(&it, &item)) {
-			adjacency_type_2 = item.key;
+		AdjacencyCount* count = node_adjacency_get(n, &digram.adj0);
+		if(!count && !(count = node_adjacency_add(node_adjacency_dict, n, &digram.adj0)))
+			return -1;
+		count->count++;
 
-			if(cmp_adjacency_type(&digram.adj0, adjacency_type_2) != 0) {
-				count_2 = *((uint64_t*) item.val);
+		for(uint32_t j = 0; j < n->len; j++) {
+			adjacency_type_2 = n->data + j;
 
-				if(count <= count_2) {
-					digram.adj1 = *adjacency_type_2;
+			if(adjacency_type_2 != count && count->count <= adjacency_type_2->count) {
+				digram.adj1 = adjacency_type_2->adj;
 
-					// update the digram count only, if the rank of the digram does not exceeds the max rank.
-					if(!digram_over_max_rank(g, max_rank, &digram))
-						update_digram_count_delta(digram_count, &digram, +1);
-				}
+				// update the digram count only, if the rank of the digram does not exceeds the max rank.
+				if(!digram_over_max_rank(g, max_rank, &digram) && update_digram_count_delta(digram_count, &digram, +1) < 0)
+					return -1;
 			}
 		}
 
-		if(count % 2 == 0) {
+		if(count->count % 2 == 0) {
 			digram.adj1 = digram.adj0;
 
 			// update the digram count only, if the rank of the digram does not exceeds the max rank.
-			if(!digram_over_max_rank(g, max_rank, &digram))
-				update_digram_count_delta(digram_count, &digram, +1);
+			if(!digram_over_max_rank(g, max_rank, &digram) && update_digram_count_delta(digram_count, &digram, +1) < 0)
+				return -1;
 		}
 	}
 
 	return 0;
 }
 
-static int repair_replace_digrams(SLHRGrammar* g, size_t nodes, int max_rank) {
+// Determines the maximum number of digrams in memory, so the data structures of the replacement
+// do not exceed `max_memory` bytes. At least an eighth of the memory is left for the digrams.
+static size_t repair_digram_count_max_len(SLHRGrammar* g, HGraph* start_rule, const NodeAdjacencyDict* adj_dict, const OccurrenceDict* occurrences, size_t max_memory) {
+	if(max_memory == 0)
+		return 0;
+
+	// the edges in memory may grow up to the limit of the arena
+	size_t used = MAX(g->arena->mem_size, g->arena->limit)
+		+ start_rule->cap * sizeof(HEdge*)
+		+ adj_dict->nodes * sizeof(NodeAdjacency) + adj_dict->pool_len * sizeof(AdjacencyCount)
+		+ occurrences->len * sizeof(NodeEdge) + occurrences->map.cap * (sizeof(AdjacencyEdgeMapEntry) + 1);
+
+	size_t bytes = used < max_memory ? max_memory - used : 0;
+	return digram_count_max_len(MAX(bytes, max_memory / 8));
+}
+
+// Number of replaced occurrences after which the pages of the mapped edges are released
+#define REPAIR_RELEASE_INTERVAL (1 << 16)
+
+// Replaces the occurrences of `digram_to_replace` by the nonterminal of a new rule.
+static int repair_replace_digram(SLHRGrammar* g, int max_rank, const Digram* digram_to_replace, NodeAdjacencyDict* adj_dict, OccurrenceDict* occurrences, OccStateList* candidates, DigramCount* digram_count, size_t* replaced) {
 	int result = -1;
 
 	HGraph* start_rule = slhr_grammar_rule_get(g, START_SYMBOL);
 
-	NodeAdjacencyDict adj_dict;
-	if(repair_create_node_adjacency_dict(start_rule, nodes, &adj_dict) < 0)
+	RuleCreator new_rule;
+	if(rule_creator_digram_init(&new_rule, g, digram_to_replace) < 0)
 		return -1;
 
-	Hashmap* digram_count = repair_count_digrams(&adj_dict);
-	if(!digram_count)
-		goto free_adj_dict;
+	if(occurrence_dict_candidates(occurrences, start_rule, adj_dict, digram_to_replace, candidates) < 0)
+		goto free_rule_creator;
 
-	RuleCreator new_rule;
-	new_rule.rule = NULL;
+	bool rule_created = false;
 
-	Digram digram_to_replace;
-	while(repair_digram_to_replace(g, digram_count, &digram_to_replace)) {
-		if(rule_creator_digram_init(&new_rule, g, &digram_to_replace) < 0)
-			goto free_rule_creator;
+	OccState current_state_object;
+	if(occ_state_init(&current_state_object) < 0)
+		goto free_rule_creator;
 
-		bool rule_created = false;
+	size_t occurrence_of_digram[2];
+	int occ_res;
+	while((occ_res = find_occurrence_of_digram(digram_to_replace, start_rule, candidates, &current_state_object, occurrence_of_digram)) == 1) {
+		HEdge* old_edges[2];
+		old_edges[0] = hgraph_edge_get(start_rule, occurrence_of_digram[0]);
+		old_edges[1] = hgraph_edge_get(start_rule, occurrence_of_digram[1]);
+		size_t removed = old_edges[0]->rank + old_edges[1]->rank;
 
-		OccState current_state_object;
-		if(occ_state_init(&current_state_object) < 0)
-			goto free_rule_creator;
+		HEdge* new_edge = rule_creator_digram_new_edge(&new_rule, old_edges[0], old_edges[1]);
+		if(!new_edge)
+			goto free_occ_state;
 
-		size_t occurrence_of_digram[2];
-		int occ_res;
-		while((occ_res = find_occurrence_of_digram(&digram_to_replace, start_rule, &current_state_object, occurrence_of_digram)) == 1) {
-			HEdge* old_edges[2];
-			old_edges[0] = hgraph_edge_get(start_rule, occurrence_of_digram[0]);
-			old_edges[1] = hgraph_edge_get(start_rule, occurrence_of_digram[1]);
+		if(!rule_created) {
+			// The rule is be created before updating the digram count because to determine the rank of the digram,
+			// the rule needs to occur in the grammar.
+			if(slhr_grammar_rule_add(g, new_rule.rule_name, new_rule.rule) < 0)
+				goto free_occ_state;
 
-			HEdge* new_edge = rule_creator_digram_new_edge(&new_rule, old_edges[0], old_edges[1]);
-			if(!new_edge)
-				goto free_rule_creator;
+			rule_creator_no_free(&new_rule);
+			rule_created = true;
+		}
 
-			if(!rule_created) {
-				// The rule is be created before updating the digram count because to determine the rank of the digram,
-				// the rule needs to occur in the grammar.
-				if(slhr_grammar_rule_add(g, new_rule.rule_name, new_rule.rule) < 0)
-					goto free_rule_creator;
+		// The digram count will be updated before the old edges are replaced
+		if(update_digram_count(g, max_rank, old_edges, new_edge, adj_dict, digram_count) < 0)
+			goto free_occ_state;
+		if(digram_count_ensure_limit(digram_count) < 0)
+			goto free_occ_state;
 
-				rule_creator_no_free(&new_rule);
-				rule_created = true;
-			}
+		// It does not really matter with edge will be replaced and deleted,
+		// because the deleted edges will be filled after the loop.
+		hgraph_edge_replace(start_rule, occurrence_of_digram[0], new_edge);
+		hgraph_edge_free(start_rule, occurrence_of_digram[1]);
 
-			// The digram count will be updated before the old edges are replaced
-			update_digram_count(g, max_rank, old_edges, new_edge, &adj_dict, digram_count);
+		// The indices of the old edges are removed from their lists the next time these lists are used.
+		if(occurrence_dict_add(occurrences, start_rule, new_edge, occurrence_of_digram[0], removed) < 0)
+			goto free_occ_state;
 
-			// It does not really matter with edge will be replaced and deleted,
-			// because the deleted edges will be filled after the loop.
-			hgraph_edge_replace(start_rule, occurrence_of_digram[0], new_edge);
-			hgraph_edge_free(start_rule, occurrence_of_digram[1]);
-		}
-		if(occ_res < 0) // error happened
-			goto free_rule_creator;
+		if(++(*replaced) % REPAIR_RELEASE_INTERVAL == 0)
+			hedge_arena_release(g->arena);
+	}
+	if(occ_res < 0) // error happened
+		goto free_occ_state;
 
-		occ_state_destroy(&current_state_object);
+	if(rule_created)
+		occurrence_dict_sort(occurrences, new_rule.rule_name, slhr_grammar_rank_of_rule(g, new_rule.rule_name));
+	result = 0;
 
-		hashmap_remove(digram_count, &digram_to_replace, sizeof(digram_to_replace));
-		rule_creator_destroy(&new_rule);
+free_occ_state:
+	occ_state_destroy(&current_state_object);
+free_rule_creator:
+	// destroy the rule because this is needed if the loop was terminated because of an error.
+	rule_creator_destroy(&new_rule);
+	return result;
+}
+
+// In each round, a batch of up to `batch` digrams is replaced, see `repair_digrams_to_replace`.
+// With a batch of 1 digram, the most frequent digram is always replaced.
+static int repair_replace_digrams(SLHRGrammar* g, size_t nodes, int max_rank, int threads, size_t max_memory, int batch) {
+	int result = -1;
+
+	HGraph* start_rule = slhr_grammar_rule_get(g, START_SYMBOL);
+	size_t k = batch > 1 ? batch : 1;
+
+	NodeAdjacencyDict adj_dict;
+	if(repair_create_node_adjacency_dict(start_rule, nodes, threads, &adj_dict) < 0)
+		return -1;
+
+	OccurrenceDict occurrences;
+	if(occurrence_dict_init(&occurrences, start_rule) < 0)
+		goto free_adj_dict;
+
+	size_t max_len = repair_digram_count_max_len(g, start_rule, &adj_dict, &occurrences, max_memory);
+
+	DigramCount digram_count;
+	if(repair_count_digrams(&adj_dict, threads, max_len, &digram_count) < 0)
+		goto free_occurrences;
+
+	Digram* digrams = malloc(k * sizeof(*digrams));
+	if(!digrams)
+		goto free_digram_count;
+	size_t* scanned = malloc(k * REPAIR_BATCH_SCAN * sizeof(*scanned));
+	if(!scanned)
+		goto free_digrams;
+
+	hedge_arena_release(g->arena);
+	size_t replaced = 0;
+
+	OccStateList candidates = {0, 0, NULL};
+
+	size_t len;
+	int replace_res;
+	while((replace_res = repair_digrams_to_replace(g, &digram_count, k, digrams, &len, scanned)) == 1) {
+		size_t i;
+		for(i = 0; i < len; i++)
+			if(repair_replace_digram(g, max_rank, &digrams[i], &adj_dict, &occurrences, &candidates, &digram_count, &replaced) < 0)
+				goto free_candidates;
+
+		// the digrams of the batch do not share labels, so their frequencies did not change
+		for(i = 0; i < len; i++)
+			digram_count_remove(&digram_count, &digrams[i]);
 	}
+	if(replace_res < 0)
+		goto free_candidates;
 
 	// removing holes with NULL edges in the grammar
 	hgraph_fill_holes(start_rule);
 
 	result = 0;
 
-free_rule_creator:
-	// destroy the rule because this is needed if the loop was terminated because of an error.
-	rule_creator_destroy(&new_rule);
-
+free_candidates:
+	if(candidates.data)
+		free(candidates.data);
+	free(scanned);
+free_digrams:
+	free(digrams);
 free_digram_count:
-	hashmap_destroy(digram_count);
+	digram_count_destroy(&digram_count);
+free_occurrences:
+	occurrence_dict_destroy(&occurrences);
 
 free_adj_dict:
-	for(size_t i = 0; i < adj_dict.nodes; i++)
-		if(adj_dict.dict[i])
-			hashmap_destroy(adj_dict.dict[i]);
-	free(adj_dict.dict);
+	node_adjacency_dict_destroy(&adj_dict);
 
 	return result;
 }
 
-static Hashmap* repair_count_monograms(HGraph* start_rule) {
-	Hashmap* monogram_dict = hashmap_init(cmp_monogram_type_cb, hash_monogram_type_cb);
-	if(!monogram_dict)
-		return NULL;
+FLATMAP_DEFINE(NodeConnectionMap, node_connection_map, uint64_t, OccStateList, hash_uint, eq_uint)
+
+static void node_connection_map_clear_lists(NodeConnectionMap* m) {
+	size_t pos = 0;
+	NodeConnectionMapEntry* e;
+
+	while((e = node_connection_map_next(m, &pos)) != NULL) {
+		if(e->val.data)
+			free(e->val.data);
+	}
+	node_connection_map_clear(m);
+}
+
+static int repair_count_monograms(HGraph* start_rule, MonogramCountMap* monogram_dict) {
+	monogram_count_map_init(monogram_dict);
 
 	// Init at first and clear after any loop
-	Hashmap* nodes_connection_type_dict = hashmap_init(cmp_uint_cb, hash_uint_cb);
-	if(!nodes_connection_type_dict)
-		goto err_0;
+	NodeConnectionMap nodes_connection_type_dict;
+	node_connection_map_init(&nodes_connection_type_dict);
 
 	size_t len = hgraph_len(start_rule);
 	for(size_t edge_id = 0; edge_id < len; edge_id++) {
@@ -929,34 +2308,33 @@ static Hashmap* repair_count_monograms(HGraph* start_rule) {
 		for(size_t connection_type = 0; connection_type < e->rank; connection_type++) {
 			uint64_t node = e->nodes[connection_type];
 
-			OccStateList* l = hashmap_get(nodes_connection_type_dict, &node, sizeof(node), NULL);
-			if(l) {
+			bool added;
+			OccStateList* l = node_connection_map_put(&nodes_connection_type_dict, &node, &added);
+			if(!l)
+				goto err_1;
+
+			if(!added) {
 				// add connection type to node
 				if(occ_state_list_append(l, connection_type) < 0)
 					goto err_1;
 			}
 			else {
 				// init list of connection types of current node
-				OccStateList l_tmp;
-				if(occ_state_list_init(&l_tmp, connection_type) < 0)
-					goto err_1;
-
-				if(hashmap_put(nodes_connection_type_dict, &node, sizeof(node), &l_tmp, sizeof(l_tmp)) < 0) {
-					free(l_tmp.data);
+				if(occ_state_list_init(l, connection_type) < 0) {
+					node_connection_map_remove(&nodes_connection_type_dict, &node);
 					goto err_1;
 				}
 			}
 		}
 
-		HashmapIterator it;
-		hashmap_iter(nodes_connection_type_dict, &it);
-		MapItem item;
+		size_t pos = 0;
+		NodeConnectionMapEntry* item;
 
 		Monogram monogram;
 		monogram.label = e->label;
 
-		while(hashmap_iter_next(&it, &item)) {
-			OccStateList* connection_type_list = item.val;
+		while((item = node_connection_map_next(&nodes_connection_type_dict, &pos)) != NULL) {
+			OccStateList* connection_type_list = &item->val;
 
 			if(connection_type_list->len > 1) {
 				for(size_t i = 0; i < connection_type_list->len; i++) {
@@ -965,32 +2343,27 @@ static Hashmap* repair_count_monograms(HGraph* start_rule) {
 					for(size_t j = i + 1; j < connection_type_list->len; j++) {
 						monogram.conn1 = connection_type_list->data[j];
 
-						uint64_t* count = hashmap_get(monogram_dict, &monogram, sizeof(monogram), NULL);
-						if(!count) {
-							uint64_t count_tmp = 1;
-							hashmap_put(monogram_dict, &monogram, sizeof(monogram), &count_tmp, sizeof(count_tmp));
-						}
-						else
-							(*count)++;
+						uint64_t* count = monogram_count_map_put(monogram_dict, &monogram, NULL);
+						if(!count)
+							goto err_1;
+						(*count)++;
 					}
 				}
 			}
 		}
 
-		occ_state_destroy_items(nodes_connection_type_dict);
-		hashmap_clear(nodes_connection_type_dict);
+		node_connection_map_clear_lists(&nodes_connection_type_dict);
 	}
 
-	hashmap_destroy(nodes_connection_type_dict);
+	node_connection_map_destroy(&nodes_connection_type_dict);
 
-	return monogram_dict;
+	return 0;
 
 err_1:
-	occ_state_destroy_items(nodes_connection_type_dict);
-	hashmap_destroy(nodes_connection_type_dict);
-err_0:
-	hashmap_destroy(monogram_dict);
-	return NULL;
+	node_connection_map_clear_lists(&nodes_connection_type_dict);
+	node_connection_map_destroy(&nodes_connection_type_dict);
+	monogram_count_map_destroy(monogram_dict);
+	return -1;
 }
 
 static inline bool should_continue_replacing_monogram(SLHRGrammar* grammar, const Monogram* monogram, uint64_t n) {
@@ -1000,20 +2373,19 @@ static inline bool should_continue_replacing_monogram(SLHRGrammar* grammar, cons
 	return n * m + g < n * g;
 }
 
-static bool repair_monogram_to_replace(SLHRGrammar* g, Hashmap* monogram_count, Monogram* monogram) {
-	HashmapIterator it;
-	hashmap_iter(monogram_count, &it);
-	MapItem item;
+// Monograms with the same frequency are ordered by the monogram itself,
+// so the result does not depend on the order of the monograms in the map.
+static bool repair_monogram_to_replace(SLHRGrammar* g, MonogramCountMap* monogram_count, Monogram* monogram) {
+	size_t pos = 0;
+	MonogramCountMapEntry* item;
 
 	const Monogram* res = NULL;
-	uint64_t res_count = 0, item_count;
+	uint64_t res_count = 0;
 
-	while(hashmap_iter_next(&it, &item)) {
-		item_count = *((uint64_t*) item.val);
-
-		if(!res || item_count > res_count) {
-			res = item.key;
-			res_count = item_count;
+	while((item = monogram_count_map_next(monogram_count, &pos)) != NULL) {
+		if(!res || item->val > res_count || (item->val == res_count && cmp_monogram(&item->key, res) < 0)) {
+			res = &item->key;
+			res_count = item->val;
 		}
 	}
 
@@ -1039,34 +2411,33 @@ static inline bool find_occurrence_of_monogram(const Monogram* monogram_to_repla
 	return false;
 }
 
-static void update_monogram_dict(HGraph* start_rule, size_t index, HEdge* old_edge, HEdge* new_edge, Hashmap* monogram_dict, const Monogram* replaced_monogram) {
-	// In Enno Adler's implementation, a new list is created and is iterated over for the monograms,
-	// because `monogram_dict` will be modified in the loop.
-	// Since it is assumed that `old_edge->label != new_edge->label`, the changed / new monograms in
-	// `monogram_dict` are ignored in this loop and it is sufficient to iterate over the entire map.
+static int update_monogram_dict(HEdge* old_edge, HEdge* new_edge, MonogramCountMap* monogram_dict, const Monogram* replaced_monogram) {
+	// In Enno Adler's implementation, a new list is created and is iterated over for the monograms.
+	// Instead of iterating over all monograms, only the monograms of the old edge are determined,
+	// these are all pairs of connection types that are connected to the same node.
+	// Since it is assumed that `old_edge->label != new_edge->label`, the new monograms are not
+	// monograms of the old edge.
 
 	assert(old_edge->label != new_edge->label); // needs to be true to choose this efficient implementation of `update_monogram_dict`
 
-	HashmapIterator it;
-	hashmap_iter(monogram_dict, &it);
-	MapItem item;
-
-	size_t i = 0;
-	while(hashmap_iter_next(&it, &item)) {
-		const Monogram* monogram = item.key;
+	Monogram monogram;
+	monogram.label = old_edge->label;
 
-		if(monogram->label == old_edge->label && old_edge->nodes[monogram->conn0] == old_edge->nodes[monogram->conn1]) {
-			uint64_t* count = item.val;
+	for(size_t conn0 = 0; conn0 < old_edge->rank; conn0++) {
+		for(size_t conn1 = conn0 + 1; conn1 < old_edge->rank; conn1++) {
+			if(old_edge->nodes[conn0] != old_edge->nodes[conn1])
+				continue;
 
-			(*count)--;
+			monogram.conn0 = conn0;
+			monogram.conn1 = conn1;
 
-			// Could be possible that monogram gets deleted so connection types will be saved for later
-			size_t conn0 = monogram->conn0;
-			size_t conn1 = monogram->conn1;
+			uint64_t* count = monogram_count_map_get(monogram_dict, &monogram);
+			if(!count)
+				continue;
 
-			// because `monogram` and `count` are not needed anymore, the element can be removed without problems
+			(*count)--;
 			if(*count == 0)
-				hashmap_iter_remove(&it);
+				monogram_count_map_remove(monogram_dict, &monogram);
 
 			if(conn0 != replaced_monogram->conn1 && conn1 != replaced_monogram->conn1) {
 				Monogram new_mono;
@@ -1076,17 +2447,15 @@ static void update_monogram_dict(HGraph* start_rule, size_t index, HEdge* old_ed
 				if(new_mono.conn0 < new_mono.conn1) {
 					new_mono.label = new_edge->label;
 
-					count = hashmap_get(monogram_dict, &new_mono, sizeof(new_mono), NULL);
-					if(count)
-						(*count)++;
-					else {
-						uint64_t count_tmp = 1;
-						hashmap_put(monogram_dict, &new_mono, sizeof(new_mono), &count_tmp, sizeof(count_tmp));
-					}
+					if(!(count = monogram_count_map_put(monogram_dict, &new_mono, NULL)))
+						return -1;
+					(*count)++;
 				}
 			}
 		}
 	}
+
+	return 0;
 }
 
 static int repair_replace_monograms(SLHRGrammar* g) {
@@ -1094,15 +2463,15 @@ static int repair_replace_monograms(SLHRGrammar* g) {
 
 	HGraph* start_rule = slhr_grammar_rule_get(g, START_SYMBOL);
 
-	Hashmap* monogram_count = repair_count_monograms(start_rule);
-	if(!monogram_count)
+	MonogramCountMap monogram_count;
+	if(repair_count_monograms(start_rule, &monogram_count) < 0)
 		return -1;
 
 	RuleCreator new_rule;
 	new_rule.rule = NULL;
 
 	Monogram monogram_to_replace;
-	while(repair_monogram_to_replace(g, monogram_count, &monogram_to_replace)) {
+	while(repair_monogram_to_replace(g, &monogram_count, &monogram_to_replace)) {
 		if(rule_creator_monogram_init(&new_rule, g, &monogram_to_replace) < 0)
 			goto free_digram_count;
 
@@ -1117,8 +2486,10 @@ static int repair_replace_monograms(SLHRGrammar* g) {
 
 			hgraph_edge_set(start_rule, index, new_edge); // set and not replace because the old edge is already needed
 
-			update_monogram_dict(start_rule, index, old_edge, new_edge, monogram_count, &monogram_to_replace);
-			free(old_edge);
+			int update_res = update_monogram_dict(old_edge, new_edge, &monogram_count, &monogram_to_replace);
+			hedge_arena_free(start_rule->arena, old_edge);
+			if(update_res < 0)
+				goto free_rule_creator;
 
 			add_rule = true;
 		}
@@ -1130,7 +2501,7 @@ static int repair_replace_monograms(SLHRGrammar* g) {
 			rule_creator_no_free(&new_rule);
 		}
 
-		hashmap_remove(monogram_count, &monogram_to_replace, sizeof(monogram_to_replace));
+		monogram_count_map_remove(&monogram_count, &monogram_to_replace);
 		rule_creator_destroy(&new_rule);
 	}
 
@@ -1140,45 +2511,126 @@ free_rule_creator:
 	rule_creator_destroy(&new_rule);
 
 free_digram_count:
-	hashmap_destroy(monogram_count);
+	monogram_count_map_destroy(&monogram_count);
 
 	return result;
 }
 
-static Hashmap* repair_count_rules(SLHRGrammar* grammar) {
-	Hashmap* rule_dict = hashmap_init(cmp_uint_cb, hash_uint_cb);
-	if(!rule_dict)
-		return NULL;
+// Position of an edge in a rule which references a nonterminal
+typedef struct {
+	uint64_t rule;
+	size_t index;
+} RuleRef;
 
-	uint64_t next = START_SYMBOL;
-	uint64_t i;
-	while(slhr_grammar_next_rule(grammar, &next, &i)) {
-		HGraph* rule = slhr_grammar_rule_get(grammar, i);
+typedef struct {
+	size_t len;
+	size_t cap;
+	RuleRef* data;
+} RuleRefList;
 
-		size_t len = hgraph_len(rule);
-		for(size_t j = 0; j < len; j++) {
-			HEdge* edge = hgraph_edge_get(rule, j);
+// Reverse index from the nonterminals to the edges referencing them.
+// The lists may contain references to rules that have already been inserted,
+// these are skipped when a list is used.
+typedef struct {
+	uint64_t min_nt;
+	size_t len; // number of nonterminals
+	uint64_t* counts; // number of occurrences of a nonterminal
+	RuleRefList* refs;
+	PQueue queue; // referenced nonterminals ordered by their number of occurrences
+} RuleIndex;
+
+static int rule_ref_list_append(RuleRefList* l, uint64_t rule, size_t index) {
+	if(l->len == l->cap) {
+		size_t cap = l->cap == 0 ? 4 : 2 * l->cap;
+		RuleRef* tmp = realloc(l->data, cap * sizeof(*tmp));
+		if(!tmp)
+			return -1;
+
+		l->cap = cap;
+		l->data = tmp;
+	}
 
-			uint64_t* count = hashmap_get(rule_dict, &edge->label, sizeof(edge->label), NULL);
-			if(count)
-				(*count)++;
-			else {
-				uint64_t count_tmp = 1;
-				hashmap_put(rule_dict, &edge->label, sizeof(edge->label), &count_tmp, sizeof(count_tmp));
-			}
-		}
+	l->data[l->len].rule = rule;
+	l->data[l->len].index = index;
+	l->len++;
+	return 0;
+}
+
+static int cmp_rule_ref(const void* v1, const void* v2) {
+	const RuleRef* r1 = v1;
+	const RuleRef* r2 = v2;
+
+	if(r1->rule != r2->rule)
+		return CMP(r1->rule, r2->rule);
+	return CMP(r1->index, r2->index);
+}
+
+// Nonterminals with the same number of occurrences are ordered by their name, the greater name is inserted first.
+static int rule_index_cmp(size_t a, size_t b, void* ctx) {
+	const RuleIndex* idx = ctx;
+
+	if(idx->counts[a] != idx->counts[b])
+		return CMP(idx->counts[a], idx->counts[b]);
+	return CMP(b, a);
+}
+
+static void rule_index_destroy(RuleIndex* idx) {
+	for(size_t i = 0; i < idx->len; i++) {
+		if(idx->refs[i].data)
+			free(idx->refs[i].data);
+	}
+	free(idx->refs);
+	free(idx->counts);
+	pqueue_destroy(&idx->queue);
+}
+
+// adds the references of the nonterminal edges of `rule` at the given positions
+static int rule_index_add_edges(RuleIndex* idx, SLHRGrammar* g, uint64_t rule, HGraph* graph, size_t start, size_t end) {
+	for(size_t j = start; j < end; j++) {
+		HEdge* edge = hgraph_edge_get(graph, j);
+		if(slhr_grammar_is_terminal(g, edge->label))
+			continue;
+
+		size_t nt = edge->label - idx->min_nt;
+		if(rule_ref_list_append(&idx->refs[nt], rule, j) < 0)
+			return -1;
+
+		idx->counts[nt]++;
+		if(pqueue_contains(&idx->queue, nt))
+			pqueue_update(&idx->queue, nt);
 	}
+	return 0;
+}
+
+// Counts the occurrences of all nonterminals in the grammar.
+static int rule_index_init(RuleIndex* idx, SLHRGrammar* g) {
+	idx->min_nt = g->min_nt;
+	idx->len = g->rule_max >= g->min_nt ? g->rule_max - g->min_nt + 1 : 0;
+	pqueue_init(&idx->queue, rule_index_cmp, idx);
 
-	HashmapIterator it;
-	hashmap_iter(rule_dict, &it);
-	const uint64_t* rule_name;
+	idx->counts = calloc(idx->len, sizeof(*idx->counts));
+	idx->refs = calloc(idx->len, sizeof(*idx->refs));
+	if((!idx->counts || !idx->refs) && idx->len > 0)
+		goto err_0;
+
+	uint64_t next = START_SYMBOL;
+	uint64_t i;
+	while(slhr_grammar_next_rule(g, &next, &i)) {
+		HGraph* rule = slhr_grammar_rule_get(g, i);
+		if(rule_index_add_edges(idx, g, i, rule, 0, hgraph_len(rule)) < 0)
+			goto err_0;
+	}
 
-	while((rule_name = hashmap_iter_next_key(&it, NULL)) != NULL) {
-		if(slhr_grammar_is_terminal(grammar, *rule_name))
-			hashmap_iter_remove(&it);
+	for(size_t nt = 0; nt < idx->len; nt++) {
+		if(idx->counts[nt] > 0 && pqueue_push(&idx->queue, nt) < 0)
+			goto err_0;
 	}
 
-	return rule_dict;
+	return 0;
+
+err_0:
+	rule_index_destroy(idx);
+	return -1;
 }
 
 static inline bool should_continue_inserting_rules(SLHRGrammar* grammar, uint64_t rule_name_to_insert, uint64_t count) {
@@ -1188,77 +2640,86 @@ static inline bool should_continue_inserting_rules(SLHRGrammar* grammar, uint64_
 	return count * used_size + rule_size > count * rule_size;
 }
 
-static bool repair_rule_to_insert(SLHRGrammar* g, Hashmap* rule_dict, uint64_t* rule) {
-	HashmapIterator it;
-	hashmap_iter(rule_dict, &it);
-	MapItem item;
-
-	int64_t res = -1;
-	uint64_t res_count = UINT64_MAX, item_count;
-
-	while(hashmap_iter_next(&it, &item)) {
-		item_count = *((uint64_t*) item.val);
-
-		if(res < 0 || item_count <= res_count) {
-			res = *((int64_t*) item.key);
-			res_count = item_count;
-		}
-	}
+static bool repair_rule_to_insert(SLHRGrammar* g, RuleIndex* idx, uint64_t* rule) {
+	if(pqueue_empty(&idx->queue))
+		return false;
 
-	if(res < 0 || !should_continue_inserting_rules(g, res, res_count))
+	size_t nt = pqueue_peek(&idx->queue);
+	if(!should_continue_inserting_rules(g, nt + idx->min_nt, idx->counts[nt]))
 		return false;
 
-	*rule = res;
+	*rule = nt + idx->min_nt;
 	return true;
 }
 
-static void repair_update_rule_dict(Hashmap* rule_dict, HGraph* rule_to_insert, int count_real_replacements, SLHRGrammar* grammar) {
+static void repair_update_rule_index(RuleIndex* idx, HGraph* rule_to_insert, SLHRGrammar* grammar) {
 	size_t edge_count = hgraph_len(rule_to_insert);
 	for(size_t i = 0; i < edge_count; i++) {
 		HEdge* edge = hgraph_edge_get(rule_to_insert, i);
 
 		if(!slhr_grammar_is_terminal(grammar, edge->label)) {
-			uint64_t* count = hashmap_get(rule_dict, &edge->label, sizeof(edge->label), NULL);
-			*count += count_real_replacements - 1;
+			size_t nt = edge->label - idx->min_nt;
+
+			// the references of the inserted copies are already counted in `rule_index_add_edges`,
+			// so only the occurrence in the removed rule has to be subtracted
+			idx->counts[nt] -= 1;
+			pqueue_update(&idx->queue, nt);
 		}
 	}
 }
 
 static int repair_prune(SLHRGrammar* g) {
-	Hashmap* rule_dict = repair_count_rules(g);
-	if(!rule_dict)
+	RuleIndex idx;
+	if(rule_index_init(&idx, g) < 0)
 		return -1;
 
 	int res = -1;
 
 	uint64_t rule_name_to_insert;
-	while(repair_rule_to_insert(g, rule_dict, &rule_name_to_insert)) {
-		int count_real_replacements = 0;
-
+	while(repair_rule_to_insert(g, &idx, &rule_name_to_insert)) {
 		HGraph* rule_to_insert = slhr_grammar_rule_get(g, rule_name_to_insert);
 
-		uint64_t next = START_SYMBOL;
-		uint64_t i;
-		while(slhr_grammar_next_rule(g, &next, &i)) {
+		size_t nt = rule_name_to_insert - idx.min_nt;
+		pqueue_remove(&idx.queue, nt);
+
+		// The edges are replaced in the order of the rules and of the edges in the rules,
+		// like a scan over the whole grammar would do.
+		RuleRefList* refs = &idx.refs[nt];
+		qsort(refs->data, refs->len, sizeof(*refs->data), cmp_rule_ref);
+
+		for(size_t k = 0; k < refs->len; k++) {
+			uint64_t i = refs->data[k].rule;
+			size_t index = refs->data[k].index;
+
+			// skip references of rules that have been inserted already
+			if(i != START_SYMBOL && g->rules[i - g->min_nt] == NULL)
+				continue;
+
 			HGraph* rule = slhr_grammar_rule_get(g, i);
+			HEdge* edge = hgraph_edge_get(rule, index);
+			assert(edge->label == rule_name_to_insert);
 
-			for(size_t index = 0; index < hgraph_len(rule); index++) {
-				HEdge* edge = hgraph_edge_get(rule, index);
+			size_t len = hgraph_len(rule);
 
-				if(edge->label == rule_name_to_insert) {
-					// In contrast to the Python implementation, this function
-					// replaces the edges in `rule` inline
-					if(rule_inserter_edges_for_hyperedge(rule_to_insert, rule, edge, index) < 0)
-						goto exit;
+			// In contrast to the Python implementation, this function
+			// replaces the edges in `rule` inline
+			if(rule_inserter_edges_for_hyperedge(rule_to_insert, rule, edge, index) < 0)
+				goto exit;
 
-					// `edge` is already freed in `rule_inserter_edges_for_hyperedge`
-					count_real_replacements++;
-				}
-			}
+			// `edge` is already freed in `rule_inserter_edges_for_hyperedge`
+
+			// the first edge replaces `edge`, the others are appended to the rule
+			if(rule_index_add_edges(&idx, g, i, rule, index, index + 1) < 0)
+				goto exit;
+			if(rule_index_add_edges(&idx, g, i, rule, len, hgraph_len(rule)) < 0)
+				goto exit;
 		}
 
-		repair_update_rule_dict(rule_dict, rule_to_insert, count_real_replacements, g);
-		hashmap_remove(rule_dict, &rule_name_to_insert, sizeof(rule_name_to_insert));
+		repair_update_rule_index(&idx, rule_to_insert, g);
+
+		free(refs->data);
+		refs->data = NULL;
+		refs->len = refs->cap = 0;
 
 		slhr_grammar_rule_del(g, rule_name_to_insert);
 	}
@@ -1266,85 +2727,394 @@ static int repair_prune(SLHRGrammar* g) {
 	res = 0;
 
 exit:
-	hashmap_destroy(rule_dict);
+	rule_index_destroy(&idx);
 	return res;
 }
 
-static int repair_normalize(SLHRGrammar* g) {
+typedef struct {
+	HGraph** rules;
+	size_t count;
+	const uint64_t* remap; // new name of each nonterminal
+	uint64_t min_nt;
+	int id;
+	int threads;
+} NormalizeWorker;
+
+// Renames the nonterminals of the edges in the part of every rule assigned to this worker.
+static void* repair_normalize_worker(void* arg) {
+	NormalizeWorker* w = arg;
+
+	for(size_t r = 0; r < w->count; r++) {
+		HGraph* rule = w->rules[r];
+
+		size_t len = hgraph_len(rule);
+		size_t from = len * w->id / w->threads;
+		size_t to = len * (w->id + 1) / w->threads;
+		for(size_t j = from; j < to; j++) {
+			HEdge* edge = hgraph_edge_get(rule, j);
+			if(edge->label >= w->min_nt)
+				edge->label = w->remap[edge->label - w->min_nt];
+		}
+	}
+
+	return NULL;
+}
+
+// Renames the nonterminals, so they are numbered consecutively from `min_nt` on.
+static int repair_normalize(SLHRGrammar* g, int threads) {
 	if(g->rule_max == 0) // no rules exists
 		return 0;
 
 	uint64_t min_nt = g->min_nt;
-	size_t max_nt_count = g->rule_max - min_nt + 2; // +2 because the start symbol is included
+	size_t max_nt_count = g->rule_max - min_nt + 1;
 
-	uint64_t* nts = malloc(max_nt_count * sizeof(*nts));
-	if(!nts)
-		return -1;
+	if(threads < 1)
+		threads = 1;
+
+	int res = -1;
+
+	uint64_t* remap = malloc(max_nt_count * sizeof(*remap));
+	if(!remap)
+		goto err_0;
+
+	HGraph** rules = malloc((max_nt_count + 1) * sizeof(*rules)); // +1 because the start symbol is included
+	if(!rules)
+		goto err_1;
+
+	NormalizeWorker* workers = malloc(threads * sizeof(*workers));
+	if(!workers)
+		goto err_2;
 
+	// The existing rules are moved to the front, this does not overwrite other rules
+	// because the new name of a nonterminal is not greater than its old name.
 	size_t count = 0;
+	rules[count++] = g->start_symbol;
+	for(size_t index = 0; index < max_nt_count; index++) {
+		if(g->rules[index] != NULL) {
+			remap[index] = min_nt + count - 1;
+			rules[count] = g->rules[index];
+
+			g->rules[index] = NULL;
+			g->rules[count - 1] = rules[count];
+			count++;
+		}
+	}
 
-	uint64_t next = START_SYMBOL;
-	uint64_t i;
-	while(slhr_grammar_next_rule(g, &next, &i))
-		nts[count++] = i;
+	for(int i = 0; i < threads; i++) {
+		workers[i].rules = rules;
+		workers[i].count = count;
+		workers[i].remap = remap;
+		workers[i].min_nt = min_nt;
+		workers[i].id = i;
+		workers[i].threads = threads;
+	}
 
-	if(count == 1) { // only start symbol - return
-		free(nts);
-		return 0;
+	repair_run_parallel(threads, repair_normalize_worker, workers, sizeof(*workers));
+
+	g->rule_max = count > 1 ? min_nt + count - 2 : 0;
+	res = 0;
+
+	free(workers);
+err_2:
+	free(rules);
+err_1:
+	free(remap);
+err_0:
+	return res;
+}
+
+// Runs all phases of RePair on the start rule of the grammar.
+static int repair_grammar(SLHRGrammar* gr, uint64_t nodes, int max_rank, bool replace_monograms, int threads, size_t max_memory, int batch) {
+	// only replace digrams if the max rank is greater than 2
+	if(max_rank > 2 && repair_replace_digrams(gr, nodes, max_rank, threads, max_memory, batch) < 0)
+		return -1;
+	if(replace_monograms && repair_replace_monograms(gr) < 0)
+		return -1;
+	if(repair_prune(gr) < 0)
+		return -1;
+	if(repair_normalize(gr, threads) < 0)
+		return -1;
+
+	hedge_arena_release(gr->arena);
+	return 0;
+}
+
+// Merging partitions
+
+typedef const HGraph* RuleBody;
+
+static inline bool eq_rule_body(const RuleBody* r1, const RuleBody* r2) {
+	const HGraph* g1 = *r1;
+	const HGraph* g2 = *r2;
+	if(g1->rank != g2->rank || hgraph_len(g1) != hgraph_len(g2))
+		return false;
+
+	for(size_t i = 0; i < hgraph_len(g1); i++)
+		if(hedge_cmp(hgraph_edge_get(g1, i), hgraph_edge_get(g2, i)) != 0)
+			return false;
+	return true;
+}
+
+static inline uint64_t hash_rule_body(const RuleBody* r) {
+	const HGraph* g = *r;
+
+	uint64_t h = 0;
+	FLATMAP_HASH_COMBINE(h, g->rank);
+	for(size_t i = 0; i < hgraph_len(g); i++) {
+		HEdge* edge = hgraph_edge_get(g, i);
+		FLATMAP_HASH_COMBINE(h, edge->label);
+		for(size_t j = 0; j < edge->rank; j++)
+			FLATMAP_HASH_COMBINE(h, edge->nodes[j]);
 	}
+	return h;
+}
+
+FLATMAP_DEFINE(RuleBodyMap, rule_body_map, RuleBody, uint64_t, hash_rule_body, eq_rule_body)
 
-	// start with i = 1 to skip the start symbol
-	for(size_t k = 1; k < count; k++) {
-		uint64_t nt = nts[k];
-		uint64_t expected_nt = min_nt + k - 1;
+typedef struct {
+	SLHRGrammar** parts;
+	size_t count;
+	atomic_size_t* next; // next partition that is not compressed yet
+	int* res; // result of each partition
 
-		if(nt != expected_nt) {
-			uint64_t index_nt = nt - min_nt;
-			uint64_t index_expected = expected_nt - min_nt;
+	uint64_t* nodes; // number of nodes of each partition
+	int max_rank;
+	bool replace_monograms;
+	size_t max_memory;
+	int batch;
+} PartitionWorker;
 
-			g->rules[index_expected] = g->rules[index_nt];
-			g->rules[index_nt] = NULL;
+static void* repair_partition_worker(void* arg) {
+	PartitionWorker* w = arg;
 
-			next = START_SYMBOL;
-			while(slhr_grammar_next_rule(g, &next, &i)) { // replace graph in all rules
-				HGraph* graph = slhr_grammar_rule_get(g, i);
+	size_t p;
+	while((p = atomic_fetch_add(w->next, 1)) < w->count)
+		w->res[p] = repair_grammar(w->parts[p], w->nodes[p], w->max_rank, w->replace_monograms, 1, w->max_memory, w->batch);
 
-				size_t edge_count = hgraph_len(graph);
-				for(size_t j = 0; j < edge_count; j++) {
-					HEdge* edge = hgraph_edge_get(graph, j);
-					if(edge->label == nt)
-						edge->label = expected_nt;
-				}
+	return NULL;
+}
+
+// Renames the nonterminals of the edges of a partition with `remap`.
+static void repair_merge_relabel(HGraph* rule, uint64_t min_nt, const uint64_t* remap) {
+	for(size_t i = 0; i < hgraph_len(rule); i++) {
+		HEdge* edge = hgraph_edge_get(rule, i);
+		if(edge->label >= min_nt)
+			edge->label = remap[edge->label - min_nt];
+	}
+}
+
+// Moves the rules of the partition to the grammar, a rule with the same body as an existing rule is replaced by it.
+static int repair_merge_partition(SLHRGrammar* gr, SLHRGrammar* part, RuleBodyMap* bodies, uint64_t* next_nt) {
+	uint64_t min_nt = gr->min_nt;
+	size_t count = part->rule_max > 0 ? part->rule_max - min_nt + 1 : 0;
+
+	uint64_t* remap = count > 0 ? malloc(count * sizeof(*remap)) : NULL;
+	if(count > 0 && !remap)
+		return -1;
+
+	int res = -1;
+
+	// The rules are renamed in ascending order, this works because a rule only contains
+	// nonterminals created before it and these have smaller names after the normalization.
+	for(size_t index = 0; index < count; index++) {
+		HGraph* rule = part->rules[index];
+		assert(rule != NULL);
+
+		repair_merge_relabel(rule, min_nt, remap);
+
+		RuleBody body = rule;
+		bool added;
+		uint64_t* nt = rule_body_map_put(bodies, &body, &added);
+		if(!nt)
+			goto exit;
+
+		if(added) {
+			*nt = (*next_nt)++;
+			if(slhr_grammar_rule_add(gr, *nt, rule) < 0) {
+				rule_body_map_remove(bodies, &body);
+				goto exit;
 			}
+			rule->arena = gr->arena;
 		}
+		else
+			hgraph_destroy(rule);
+
+		remap[index] = *nt;
+		part->rules[index] = NULL;
+	}
+
+	HGraph* start = part->start_symbol;
+	repair_merge_relabel(start, min_nt, remap);
+	for(size_t i = 0; i < hgraph_len(start); i++) {
+		HEdge* edge = hgraph_edge_get(start, i);
+		if(edge && hgraph_add_edge(gr->start_symbol, edge) < 0)
+			goto exit;
 	}
+	start->len = 0;
 
-	g->rule_max = min_nt + count - 2;
+	if(hedge_arena_merge(gr->arena, part->arena) < 0)
+		goto exit;
 
-	free(nts);
-	return 0;
+	res = 0;
+
+exit:
+	if(remap)
+		free(remap);
+	return res;
+}
+
+// Splits the start rule into `partitions` ranges of consecutive edges, which are compressed independently
+// by `threads` threads. The rules of the partitions are merged afterwards, rules with equal bodies are merged into one.
+static int repair_partitions(SLHRGrammar* gr, int partitions, int max_rank, bool replace_monograms, int threads, size_t max_memory, int batch) {
+	HGraph* start = gr->start_symbol;
+	size_t len = hgraph_len(start);
+	size_t count = MIN((size_t) partitions, len);
+	if(threads < 1)
+		threads = 1;
+	if(threads > (int) count)
+		threads = count;
+
+	int res = -1;
+
+	SLHRGrammar** parts = calloc(count, sizeof(*parts));
+	if(!parts)
+		goto err_0;
+	int* results = malloc(count * sizeof(*results));
+	if(!results)
+		goto err_1;
+	uint64_t* nodes = calloc(count, sizeof(*nodes));
+	if(!nodes)
+		goto err_2;
+	PartitionWorker* workers = malloc(threads * sizeof(*workers));
+	if(!workers)
+		goto err_3;
+
+	// The new edges of the partitions share the memory that the edges of the start rule leave of the limit.
+	// If nothing is left, all new slabs of the partitions are mapped.
+	size_t limit = 0;
+	if(gr->arena->limit > 0)
+		limit = MAX((gr->arena->limit > gr->arena->mem_size ? gr->arena->limit - gr->arena->mem_size : 0) / count, 1);
+
+	size_t p;
+	for(p = 0; p < count; p++) {
+		size_t from = len * p / count;
+		size_t to = len * (p + 1) / count;
+
+		HEdgeArena* arena = hedge_arena_init();
+		if(!arena)
+			goto err_4;
+		hedge_arena_set_limit(arena, limit);
+
+		HGraph* part = hgraph_init(start->rank, arena);
+		if(!part || hgraph_reserve(part, to - from) < 0) {
+			if(part)
+				hgraph_destroy_without_edges(part);
+			hedge_arena_destroy(arena);
+			goto err_4;
+		}
+
+		for(size_t i = from; i < to; i++) {
+			HEdge* edge = hgraph_edge_get(start, i);
+			part->edges[part->len++] = edge;
+			for(size_t j = 0; j < edge->rank; j++)
+				nodes[p] = MAX(nodes[p], edge->nodes[j] + 1);
+		}
+
+		if(!(parts[p] = slhr_grammar_init(part, gr->min_nt))) {
+			hgraph_destroy_without_edges(part);
+			hedge_arena_destroy(arena);
+			goto err_4;
+		}
+	}
+
+	// the edges are owned by the partitions now, the merged start rule reuses the memory of the edge pointers
+	start->len = 0;
+
+	atomic_size_t next;
+	atomic_init(&next, 0);
+	for(int i = 0; i < threads; i++) {
+		workers[i].parts = parts;
+		workers[i].count = count;
+		workers[i].next = &next;
+		workers[i].res = results;
+		workers[i].nodes = nodes;
+		workers[i].max_rank = max_rank;
+		workers[i].replace_monograms = replace_monograms;
+		workers[i].max_memory = max_memory / threads;
+		workers[i].batch = batch;
+	}
+
+	repair_run_parallel(threads, repair_partition_worker, workers, sizeof(*workers));
+
+	for(p = 0; p < count; p++)
+		if(results[p] < 0)
+			goto err_4;
+
+	RuleBodyMap bodies;
+	rule_body_map_init(&bodies);
+
+	uint64_t next_nt = gr->min_nt;
+	for(p = 0; p < count; p++) {
+		if(repair_merge_partition(gr, parts[p], &bodies, &next_nt) < 0) {
+			rule_body_map_destroy(&bodies);
+			goto err_4;
+		}
+
+		slhr_grammar_destroy(parts[p]);
+		parts[p] = NULL;
+	}
+
+	rule_body_map_destroy(&bodies);
+
+	// rules which are only used once after the merge are inserted again
+	if(repair_prune(gr) < 0)
+		goto err_4;
+	if(repair_normalize(gr, threads) < 0)
+		goto err_4;
+
+	hedge_arena_release(gr->arena);
+	res = 0;
+
+err_4:
+	for(p = 0; p < count; p++)
+		if(parts[p])
+			slhr_grammar_destroy(parts[p]);
+	free(workers);
+err_3:
+	free(nodes);
+err_2:
+	free(results);
+err_1:
+	free(parts);
+err_0:
+	return res;
 }
 
-SLHRGrammar* repair(HGraph* g, uint64_t nodes, uint64_t terminals, int max_rank, bool replace_monograms) {
+SLHRGrammar* repair(HGraph* g, uint64_t nodes, uint64_t terminals, int max_rank, bool replace_monograms, int threads, size_t max_memory, int partitions, int batch) {
 	SLHRGrammar* gr = slhr_grammar_init(g, terminals);
 	if(!gr) {
-		hgraph_destroy(g); // destroy the graph on errors, because the memory of the graph is fully managed in this function
+		// destroy the graph on errors, because the memory of the graph is fully managed in this function
+		HEdgeArena* arena = g->arena;
+		hgraph_destroy_without_edges(g);
+		hedge_arena_destroy(arena);
 		return NULL;
 	}
 
-	// only replace digrams if the max rank is greater than 2
-	if(max_rank > 2 && repair_replace_digrams(gr, nodes, max_rank) < 0)
-		goto repair_err;
-	if(replace_monograms && repair_replace_monograms(gr) < 0)
-		goto repair_err;
-	if(repair_prune(gr) < 0)
-		goto repair_err;
-	if(repair_normalize(gr) < 0)
-		goto repair_err;
+	int res;
+	if(partitions > 1 && hgraph_len(gr->start_symbol) > 1)
+		res = repair_partitions(gr, partitions, max_rank, replace_monograms, threads, max_memory, batch);
+	else
+		res = repair_grammar(gr, nodes, max_rank, replace_monograms, threads, max_memory, batch);
+
+	if(res < 0) {
+		slhr_grammar_destroy(gr);
+		return NULL;
+	}
 
 	return gr;
+}
 
-repair_err:
-	slhr_grammar_destroy(gr);
-	return NULL;
+int repair_append(SLHRGrammar* gr, uint64_t nodes, int max_rank, bool replace_monograms, int threads, size_t max_memory, int batch) {
+	// The partitions are compressed without the rules of the grammar, so the edges are not partitioned.
+	return repair_grammar(gr, nodes, max_rank, replace_monograms, threads, max_memory, batch);
 }
@@ -10,6 +10,17 @@
 #include <hgraph.h>
 #include <slhr_grammar.h>
 
-SLHRGrammar* repair(HGraph* g, uint64_t nodes, uint64_t terminals, int max_rank, bool replace_monograms);
+// If `max_memory` is greater than 0, the least frequent digrams are moved to temporary files
+// to keep the memory used by RePair below this number of bytes.
+// If `partitions` is greater than 1, the edges are split into this number of partitions which are compressed
+// by `threads` threads independently, the rules of the partitions are merged afterwards.
+// If `batch` is greater than 1, up to this number of frequent digrams without common labels are replaced
+// in each round instead of only the most frequent digram.
+SLHRGrammar* repair(HGraph* g, uint64_t nodes, uint64_t terminals, int max_rank, bool replace_monograms, int threads, size_t max_memory, int partitions, int batch);
+
+// Runs RePair on a grammar whose start rule may already contain nonterminals of existing rules,
+// e.g. the rules of a compressed graph that new edges are appended to. The existing rules are reused
+// for the new digrams and pruned like the new rules. The grammar is not destroyed on errors.
+int repair_append(SLHRGrammar* gr, uint64_t nodes, int max_rank, bool replace_monograms, int threads, size_t max_memory, int batch);
 
 #endif
@@ -7,8 +7,8 @@
 
 #include <stdlib.h>
 
-static HEdge* digram_build_edge(uint64_t label, size_t connection_type, size_t rank_of_rule, size_t node_offset) {
-	HEdge* edge = malloc(hedge_sizeof(rank_of_rule));
+static HEdge* digram_build_edge(HEdgeArena* arena, uint64_t label, size_t connection_type, size_t rank_of_rule, size_t node_offset) {
+	HEdge* edge = hedge_arena_alloc(arena, rank_of_rule);
 	if(!edge)
 		return NULL;
 
@@ -41,15 +41,15 @@ int rule_creator_digram_init(RuleCreator* c, SLHRGrammar* g, const Digram* digra
 	rank[0] = slhr_grammar_rank_of_rule(g, label[0]);
 	rank[1] = slhr_grammar_rank_of_rule(g, label[1]);
 
-	edges[0] = digram_build_edge(label[0], digram->adj0.conn_type, rank[0], 1);
+	edges[0] = digram_build_edge(g->arena, label[0], digram->adj0.conn_type, rank[0], 1);
 	if(!edges[0])
 		return -1;
 
-	edges[1] = digram_build_edge(label[1], digram->adj1.conn_type, rank[1], rank[0]);
+	edges[1] = digram_build_edge(g->arena, label[1], digram->adj1.conn_type, rank[1], rank[0]);
 	if(!edges[1])
 		goto err_0;
 
-	HGraph* graph = hgraph_init(rank[0] + rank[1] - 1);
+	HGraph* graph = hgraph_init(rank[0] + rank[1] - 1, g->arena);
 	if(!graph)
 		goto err_1;
 
@@ -66,16 +66,16 @@ int rule_creator_digram_init(RuleCreator* c, SLHRGrammar* g, const Digram* digra
 	return 0;
 
 err_2:
-	hgraph_destroy(graph);
+	hgraph_destroy_without_edges(graph);
 err_1:
-	free(edges[1]);
+	hedge_arena_free(g->arena, edges[1]);
 err_0:
-	free(edges[0]);
+	hedge_arena_free(g->arena, edges[0]);
 	return -1;
 }
 
-static HEdge* monogram_build_edge(uint64_t label, size_t connection_type_1, size_t connection_type_2, size_t rank_of_rule) {
-	HEdge* edge = malloc(hedge_sizeof(rank_of_rule));
+static HEdge* monogram_build_edge(HEdgeArena* arena, uint64_t label, size_t connection_type_1, size_t connection_type_2, size_t rank_of_rule) {
+	HEdge* edge = hedge_arena_alloc(arena, rank_of_rule);
 	if(!edge)
 		return NULL;
 
@@ -100,11 +100,11 @@ static HEdge* monogram_build_edge(uint64_t label, size_t connection_type_1, size
 int rule_creator_monogram_init(RuleCreator* c, SLHRGrammar* g, const Monogram* monogram) {
 	size_t rank = slhr_grammar_rank_of_rule(g, monogram->label);
 
-	HEdge* edge = monogram_build_edge(monogram->label, monogram->conn0, monogram->conn1, rank);
+	HEdge* edge = monogram_build_edge(g->arena, monogram->label, monogram->conn0, monogram->conn1, rank);
 	if(!edge)
 		return -1;
 
-	HGraph* graph = hgraph_init(rank - 1);
+	HGraph* graph = hgraph_init(rank - 1, g->arena);
 	if(!graph)
 		goto err_0;
 
@@ -119,9 +119,9 @@ int rule_creator_monogram_init(RuleCreator* c, SLHRGrammar* g, const Monogram* m
 	return 0;
 
 err_1:
-	hgraph_destroy(graph);
+	hgraph_destroy_without_edges(graph);
 err_0:
-	free(edge);
+	hedge_arena_free(g->arena, edge);
 	return -1;
 }
 
@@ -136,7 +136,7 @@ HEdge* rule_creator_digram_new_edge(RuleCreator* c, HEdge* edge_1, HEdge* edge_2
 	uint64_t shared_node = edge_1->nodes[c->digram->adj0.conn_type];
 
 	size_t rank = edge_1->rank + edge_2->rank - 1;
-	HEdge* edge = malloc(hedge_sizeof(rank));
+	HEdge* edge = hgraph_edge_alloc(c->rule, rank);
 	if(!edge)
 		return NULL;
 
@@ -162,7 +162,7 @@ HEdge* rule_creator_digram_new_edge(RuleCreator* c, HEdge* edge_1, HEdge* edge_2
 HEdge* rule_creator_monogram_new_edge(RuleCreator* c, HEdge* old_edge) {
 	size_t new_rank = old_edge->rank - 1;
 
-	HEdge* edge = malloc(hedge_sizeof(new_rank));
+	HEdge* edge = hgraph_edge_alloc(c->rule, new_rank);
 	if(!edge)
 		return NULL;
 
@@ -190,7 +190,7 @@ int rule_inserter_edges_for_hyperedge(const HGraph* rule_to_insert, HGraph* rule
 	for(i = 0; i < count; i++) {
 		HEdge* e = hgraph_edge_get(rule_to_insert, i);
 
-		HEdge* edge = malloc(hedge_sizeof(e->rank));
+		HEdge* edge = hgraph_edge_alloc(rule, e->rank);
 		if(!edge)
 			goto exit;
 
@@ -204,7 +204,7 @@ int rule_inserter_edges_for_hyperedge(const HGraph* rule_to_insert, HGraph* rule
 			hgraph_edge_set(rule, index, edge);
 		else {
 			if(hgraph_add_edge(rule, edge) < 0) {
-				free(edge);
+				hedge_arena_free(rule->arena, edge);
 				goto exit;
 			}
 		}
@@ -214,6 +214,6 @@ int rule_inserter_edges_for_hyperedge(const HGraph* rule_to_insert, HGraph* rule
 
 exit:
 	if(i > 0) // only free if the first edge has been replaced
-		free(hyperedge);
+		hedge_arena_free(rule->arena, hyperedge);
 	return res;
 }
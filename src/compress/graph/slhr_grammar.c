@@ -23,11 +23,14 @@ SLHRGrammar* slhr_grammar_init(HGraph* graph, uint64_t min_nt) {
     g->rank_of_terminal = rank_of_terminal;
     for (size_t i = 0; i < graph->len; i++)
     {
-        rank_of_terminal[graph->edges[i]->label] = graph->edges[i]->rank;
+        // the start symbol may already contain nonterminals if a compressed graph is extended
+        if (graph->edges[i]->label < min_nt)
+            rank_of_terminal[graph->edges[i]->label] = graph->edges[i]->rank;
     }
 
 	g->min_nt = min_nt;
 	g->start_symbol = graph;
+	g->arena = graph->arena;
 	g->rule_max = 0;
 	g->rules_cap = 0;
 	g->rules = NULL;
@@ -36,13 +39,15 @@ SLHRGrammar* slhr_grammar_init(HGraph* graph, uint64_t min_nt) {
 }
 
 void slhr_grammar_destroy(SLHRGrammar* g) {
-	hgraph_destroy(g->start_symbol);
+	// the edges are freed at once with the arena
+	hgraph_destroy_without_edges(g->start_symbol);
     if (g->rank_of_terminal)
         free(g->rank_of_terminal);
 	for(size_t i = 0; i < g->rules_cap; i++)
 		if(g->rules[i])
-			hgraph_destroy(g->rules[i]);
+			hgraph_destroy_without_edges(g->rules[i]);
 	free(g->rules);
+	hedge_arena_destroy(g->arena);
 	free(g);
 }
 
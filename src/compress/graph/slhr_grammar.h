@@ -15,6 +15,7 @@
 typedef struct {
 	uint64_t min_nt;
 	HGraph* start_symbol;
+	HEdgeArena* arena; // memory of the edges of all rules
     size_t* rank_of_terminal;
 
 	size_t rule_max; // eventuell entfernen?
@@ -22,6 +23,8 @@ typedef struct {
 	HGraph** rules;
 } SLHRGrammar;
 
+// The grammar takes the ownership of the graph and of the arena of its edges.
+// All rules of the grammar must allocate their edges in this arena.
 SLHRGrammar* slhr_grammar_init(HGraph* graph, uint64_t terminals);
 void slhr_grammar_destroy(SLHRGrammar* g);
 
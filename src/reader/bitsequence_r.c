@@ -111,15 +111,16 @@ static uint64_t get_bits(BitsequenceReader* b, FileOff offset, FileOff start, ui
 	int off = pos % 8;
 	uint64_t mask = ((uint64_t) 1 << length) - 1;
 
-	reader_bitpos(&b->r, 8 * (pos / 8));
+	Reader r = b->r;
+	reader_bitpos(&r, 8 * (pos / 8));
 
 	if(off + length <= 8) // shortcut if bits do not cross the boundaries of bytes
-		return (reader_readbyte(&b->r) >> (8 - off - length)) & mask;
+		return (reader_readbyte(&r) >> (8 - off - length)) & mask;
 
 	int byte_len = BYTE_LEN(off + length);
 	int shift = 8 * byte_len - length - off;
 
-	const uint8_t* data = reader_read(&b->r, byte_len);
+	const uint8_t* data = reader_read(&r, byte_len);
 
 	uint64_t val = 0;
 	for(int i = 0; i < byte_len; i++)
@@ -159,8 +160,9 @@ bool bitsequence_reader_access(BitsequenceReader* b, uint64_t i) {
 		return access_rrr(b, i);
 #endif
 
-	reader_bitpos(&b->r, b->off + i);
-	return reader_readbit(&b->r);
+	Reader r = b->r;
+	reader_bitpos(&r, b->off + i);
+	return reader_readbit(&r);
 }
 
 uint64_t bitsequence_reader_rank0(BitsequenceReader* b, int64_t i) {
@@ -174,12 +176,14 @@ static uint64_t rs_value(BitsequenceReader* b, int64_t i) {
 	if(i == 0)
 		return 0;
 
-	reader_bitpos(&b->r, b->rs_off + b->bits_per_rs * (i - 1));
-	return reader_readint(&b->r, b->bits_per_rs);
+	Reader r = b->r;
+	reader_bitpos(&r, b->rs_off + b->bits_per_rs * (i - 1));
+	return reader_readint(&r, b->bits_per_rs);
 }
 
 #ifdef RRR
-static uint64_t rank1_rrr(BitsequenceReader* b, uint64_t i) {
+// If `bit` is not NULL, the bit at the position i is written to it, the block is decoded anyway.
+static uint64_t rank1_rrr(BitsequenceReader* b, uint64_t i, bool* bit) {
 	FileOff block = i / BITS_PER_BLOCK;
 	FileOff super_block = block / b->sample_rate;
 
@@ -217,8 +221,12 @@ static uint64_t rank1_rrr(BitsequenceReader* b, uint64_t i) {
 
 	FileOff c = get_field(b, b->offset_block_types, BLOCK_TYPE_BITS, block);
 	FileOff offset = get_bits(b, b->offset_block_ranks, rank, table_class_size(c));
+	uint32_t bitmap = table_short_bitmap(c, offset);
 
-	c_sum += POPCNT32(((2 << (i % BITS_PER_BLOCK)) - 1) & table_short_bitmap(c, offset));
+	if(bit)
+		*bit = (bitmap >> (i % BITS_PER_BLOCK)) & 1;
+
+	c_sum += POPCNT32(((2 << (i % BITS_PER_BLOCK)) - 1) & bitmap);
 	return c_sum;
 }
 #endif
@@ -230,7 +238,7 @@ uint64_t bitsequence_reader_rank1(BitsequenceReader* b, int64_t i) {
 		return b->ones;
 #ifdef RRR
 	if(b->type == BITSEQUENCE_RRR)
-		return rank1_rrr(b, i);
+		return rank1_rrr(b, i, NULL);
 #endif
 
 	i++;
@@ -250,10 +258,11 @@ uint64_t bitsequence_reader_rank1(BitsequenceReader* b, int64_t i) {
 
 	if(bit_len) {
 		// set bitpos to first block
-		reader_bitpos(&b->r, b->off + BLOCKW * aux);
+		Reader r = b->r;
+		reader_bitpos(&r, b->off + BLOCKW * aux);
 
 		size_t byte_len = BYTE_LEN(bit_len);
-		const uint8_t* data = reader_read(&b->r, byte_len);
+		const uint8_t* data = reader_read(&r, byte_len);
 
 		int endbits = byte_len * 8 - bit_len;
 
@@ -270,13 +279,33 @@ uint64_t bitsequence_reader_rank1(BitsequenceReader* b, int64_t i) {
 	return res;
 }
 
+bool bitsequence_reader_access_rank1(BitsequenceReader* b, uint64_t i, uint64_t* rank) {
+	if(i >= b->len)
+		panic("index %" PRIu64 " exceeds the length %" PRIu64, i, b->len);
+
+#ifdef RRR
+	if(b->type == BITSEQUENCE_RRR) {
+		bool bit;
+		*rank = rank1_rrr(b, i, &bit);
+		return bit;
+	}
+#endif
+
+	if(!bitsequence_reader_access(b, i))
+		return false;
+
+	*rank = bitsequence_reader_rank1(b, i);
+	return true;
+}
+
 // This function always returns the block in big endian order.
 static inline uint32_t block_get(BitsequenceReader* b, FileOff i) {
-	reader_bitpos(&b->r, b->off + i * BLOCKW);
+	Reader r = b->r;
+	reader_bitpos(&r, b->off + i * BLOCKW);
 
 	const uint8_t* data;
 	if(i * BLOCKW + BLOCKW <= b->len) { // check if current block consists of 4 bytes
-		data = reader_read(&b->r, BLOCKW / 8);
+		data = reader_read(&r, BLOCKW / 8);
 
 #if UNALIGN_ACCESS
 		return *((uint32_t*) data);
@@ -294,7 +323,7 @@ static inline uint32_t block_get(BitsequenceReader* b, FileOff i) {
 
 	int byte_len = BYTE_LEN(b->len - i * BLOCKW);
 
-	data = reader_read(&b->r, byte_len);
+	data = reader_read(&r, byte_len);
 
 	uint32_t block = 0; // initialize with zero so the lower uncopied bytes are 0
 	memcpy(&block, data, byte_len);
@@ -54,6 +54,9 @@ bool bitsequence_reader_access(BitsequenceReader* b, uint64_t i);
 // working with signed values because we allow the value -1
 uint64_t bitsequence_reader_rank0(BitsequenceReader* b, int64_t i);
 uint64_t bitsequence_reader_rank1(BitsequenceReader* b, int64_t i);
+// Returns the bit at the position i like `bitsequence_reader_access`. If the bit is set, rank1(i) is written to `rank`.
+// For the RRR representation the block is only decoded once for both operations.
+bool bitsequence_reader_access_rank1(BitsequenceReader* b, uint64_t i, uint64_t* rank);
 int64_t bitsequence_reader_select0(BitsequenceReader* b, uint64_t i);
 int64_t bitsequence_reader_select1(BitsequenceReader* b, uint64_t i);
 int64_t bitsequence_reader_selectprev1(BitsequenceReader* b, uint64_t i);
@@ -0,0 +1,258 @@
+/**
+ * @file delta.c
+ * @author FR
+ */
+
+#include "delta.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <cgraph.h>
+#include <constants.h>
+
+static const DeltaEdgeList delta_empty_list = {0, 0, NULL};
+
+void delta_init(Delta* d) {
+	d->len = 0;
+	d->cap = 0;
+	d->edges = NULL;
+	delta_node_map_init(&d->nodes);
+	delta_id_set_init(&d->removed);
+	d->node_count = 0;
+	d->label_count = 0;
+	d->gen = 0;
+}
+
+void delta_destroy(Delta* d) {
+	for(size_t i = 0; i < d->len; i++)
+		free(d->edges[i]);
+	free(d->edges);
+
+	size_t pos = 0;
+	DeltaNodeMapEntry* entry;
+	while((entry = delta_node_map_next(&d->nodes, &pos)))
+		free(entry->val.data);
+	delta_node_map_destroy(&d->nodes);
+	delta_id_set_destroy(&d->removed);
+}
+
+// Returns true if the node occurs at a position before `i`, so each node is only indexed once per edge.
+static inline bool delta_node_before(const DeltaEdge* e, int i) {
+	for(int j = 0; j < i; j++)
+		if(e->nodes[j] == e->nodes[i])
+			return true;
+	return false;
+}
+
+static int delta_list_add(DeltaEdgeList* list, size_t v) {
+	if(list->len == list->cap) {
+		size_t cap = list->cap == 0 ? 4 : 2 * list->cap;
+		size_t* data = realloc(list->data, cap * sizeof(*data));
+		if(!data)
+			return -1;
+		list->data = data;
+		list->cap = cap;
+	}
+	list->data[list->len++] = v;
+	return 0;
+}
+
+// Replaces the value `v` in the list with `w` or removes it, if `w` is SIZE_MAX.
+static void delta_list_replace(DeltaEdgeList* list, size_t v, size_t w) {
+	for(size_t i = 0; i < list->len; i++) {
+		if(list->data[i] == v) {
+			if(w == SIZE_MAX)
+				list->data[i] = list->data[--list->len];
+			else
+				list->data[i] = w;
+			return;
+		}
+	}
+}
+
+// Replaces the index `v` of the edge `e` in the lists of its nodes with `w`, see `delta_list_replace`.
+static void delta_index_replace(Delta* d, const DeltaEdge* e, size_t v, size_t w) {
+	for(int i = 0; i < e->rank; i++) {
+		if(delta_node_before(e, i))
+			continue;
+
+		DeltaEdgeList* list = delta_node_map_get(&d->nodes, &e->nodes[i]);
+		if(!list)
+			continue;
+
+		delta_list_replace(list, v, w);
+		if(list->len == 0) {
+			free(list->data);
+			delta_node_map_remove(&d->nodes, &e->nodes[i]);
+		}
+	}
+}
+
+int delta_add(Delta* d, CGraphEdgeLabel label, CGraphRank rank, const CGraphNode* nodes) {
+	if(label < 0 || rank < 0 || rank > LIMIT_MAX_RANK)
+		return -1;
+	for(int i = 0; i < rank; i++)
+		if(nodes[i] < 0)
+			return -1;
+
+	if(d->len == d->cap) {
+		size_t cap = d->cap == 0 ? 16 : 2 * d->cap;
+		DeltaEdge** edges = realloc(d->edges, cap * sizeof(*edges));
+		if(!edges)
+			return -1;
+		d->edges = edges;
+		d->cap = cap;
+	}
+
+	DeltaEdge* e = malloc(sizeof(*e) + rank * sizeof(uint64_t));
+	if(!e)
+		return -1;
+
+	e->label = label;
+	e->gen = d->gen;
+	e->rank = rank;
+	for(int i = 0; i < rank; i++)
+		e->nodes[i] = nodes[i];
+
+	size_t idx = d->len;
+	for(int i = 0; i < rank; i++) {
+		if(delta_node_before(e, i))
+			continue;
+
+		DeltaEdgeList* list = delta_node_map_put(&d->nodes, &e->nodes[i], NULL);
+		if(!list || delta_list_add(list, idx) < 0)
+			goto err_0;
+	}
+
+	d->edges[d->len++] = e;
+
+	for(int i = 0; i < rank; i++)
+		if(e->nodes[i] + 1 > d->node_count)
+			d->node_count = e->nodes[i] + 1;
+	if(e->label + 1 > d->label_count)
+		d->label_count = e->label + 1;
+
+	return 0;
+
+err_0:
+	// the nodes added so far are removed again, an empty list may remain if `delta_node_map_put` failed
+	delta_index_replace(d, e, idx, SIZE_MAX);
+	free(e);
+	return -1;
+}
+
+// Removes the edge at the index `i`, the last edge is moved to this index.
+static void delta_remove_at(Delta* d, size_t i) {
+	DeltaEdge* e = d->edges[i];
+	delta_index_replace(d, e, i, SIZE_MAX);
+
+	size_t last = d->len - 1;
+	if(i != last) {
+		DeltaEdge* moved = d->edges[last];
+		delta_index_replace(d, moved, last, i);
+		d->edges[i] = moved;
+	}
+
+	d->len--;
+	free(e);
+}
+
+bool delta_remove(Delta* d, CGraphEdgeLabel label, CGraphRank rank, const CGraphNode* nodes, uint64_t min_gen) {
+	if(rank <= 0)
+		return false;
+
+	DeltaEdgeList* list = delta_node_map_get(&d->nodes, (const uint64_t*) &nodes[0]);
+	if(!list)
+		return false;
+
+	for(size_t k = 0; k < list->len; k++) {
+		size_t i = list->data[k];
+		DeltaEdge* e = d->edges[i];
+		if(e->label != (uint64_t) label || e->rank != rank || e->gen < min_gen)
+			continue;
+		if(memcmp(e->nodes, nodes, rank * sizeof(uint64_t)) != 0)
+			continue;
+
+		delta_remove_at(d, i);
+		return true;
+	}
+
+	return false;
+}
+
+void delta_remove_before(Delta* d, uint64_t gen) {
+	// The edges are iterated backwards, so the edge moved to the position was already checked.
+	for(size_t i = d->len; i > 0; i--) {
+		if(d->edges[i - 1]->gen < gen)
+			delta_remove_at(d, i - 1);
+	}
+}
+
+int delta_remove_start_edge(Delta* d, uint64_t edge) {
+	return delta_id_set_put(&d->removed, &edge, NULL) ? 0 : -1;
+}
+
+void delta_iter(const Delta* d, int query_type, CGraphRank rank, const CGraphNode* nodes, DeltaIterator* it) {
+	it->d = d;
+	it->query_type = query_type;
+	it->rank = rank;
+	it->nodes = nodes;
+	it->list = NULL;
+	it->pos = 0;
+
+	// The edges at the bound node with the fewest edges are the candidates.
+	for(int i = 0; nodes && i < rank; i++) {
+		if(nodes[i] == CGRAPH_NODES_ALL)
+			continue;
+
+		const DeltaEdgeList* list = delta_node_map_get(&d->nodes, (const uint64_t*) &nodes[i]);
+		if(!list) {
+			it->list = &delta_empty_list;
+			return;
+		}
+		if(!it->list || list->len < it->list->len)
+			it->list = list;
+	}
+}
+
+// Checks if the edge matches the query like `decompress` of the grammar.
+static bool delta_edge_matches(const DeltaIterator* it, const DeltaEdge* e) {
+	if(it->rank != CGRAPH_NODES_ALL && it->query_type == CGRAPH_EXACT_QUERY && it->rank != e->rank)
+		return false;
+
+	for(int i = 0; it->nodes && i < it->rank; i++) {
+		if(it->nodes[i] == CGRAPH_NODES_ALL)
+			continue;
+
+		bool found = false;
+		for(int j = 0; j < e->rank && !found; j++)
+			found = e->nodes[j] == (uint64_t) it->nodes[i];
+		if(!found)
+			return false;
+	}
+
+	return true;
+}
+
+bool delta_iter_next(DeltaIterator* it, CGraphEdge* e) {
+	const Delta* d = it->d;
+	size_t len = it->list ? it->list->len : d->len;
+
+	while(it->pos < len) {
+		size_t i = it->list ? it->list->data[it->pos] : it->pos;
+		it->pos++;
+
+		const DeltaEdge* de = d->edges[i];
+		if(!delta_edge_matches(it, de))
+			continue;
+
+		if(e) {
+			e->label = de->label;
+			e->rank = de->rank;
+			e->nodes = (CGraphNode*) de->nodes;
+		}
+		return true;
+	}
+
+	return false;
+}
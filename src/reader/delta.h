@@ -0,0 +1,87 @@
+/**
+ * @file delta.h
+ * @author FR
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <cgraph.h>
+#include <flatmap.h>
+
+// Edge added to a compressed graph
+typedef struct {
+	uint64_t label;
+	uint64_t gen; // generation of the delta the edge was added in
+	int rank;
+	uint64_t nodes[0];
+} DeltaEdge;
+
+// Indices of the edges in the delta
+typedef struct {
+	size_t len;
+	size_t cap;
+	size_t* data;
+} DeltaEdgeList;
+
+static inline uint64_t delta_hash_uint(const uint64_t* v) {
+	return flatmap_mix64(*v);
+}
+
+static inline bool delta_eq_uint(const uint64_t* v1, const uint64_t* v2) {
+	return *v1 == *v2;
+}
+
+FLATMAP_DEFINE(DeltaNodeMap, delta_node_map, uint64_t, DeltaEdgeList, delta_hash_uint, delta_eq_uint)
+FLATMAP_DEFINE(DeltaIdSet, delta_id_set, uint64_t, bool, delta_hash_uint, delta_eq_uint)
+
+// Changes of a compressed graph that are kept in memory: the added edges and the removed edges of the start symbol.
+// The added edges are indexed by their nodes, so the edges at a node are found without a scan over all edges.
+typedef struct {
+	size_t len;
+	size_t cap;
+	DeltaEdge** edges;
+
+	DeltaNodeMap nodes; // edges at each node
+	DeltaIdSet removed; // ids of the removed edges of the start symbol
+
+	uint64_t node_count; // highest node of the added edges + 1
+	uint64_t label_count; // highest label of the added edges + 1
+	uint64_t gen; // current generation, the added edges get this generation
+} Delta;
+
+void delta_init(Delta* d);
+void delta_destroy(Delta* d);
+
+int delta_add(Delta* d, CGraphEdgeLabel label, CGraphRank rank, const CGraphNode* nodes);
+// Removes an added edge of the generation `min_gen` or a newer one.
+// Returns true if the edge was removed, false if no such edge exists.
+bool delta_remove(Delta* d, CGraphEdgeLabel label, CGraphRank rank, const CGraphNode* nodes, uint64_t min_gen);
+// Removes all added edges of generations before `gen`.
+void delta_remove_before(Delta* d, uint64_t gen);
+
+int delta_remove_start_edge(Delta* d, uint64_t edge);
+#define delta_start_edge_removed(d, edge) ((d)->removed.len > 0 && delta_id_set_get(&(d)->removed, &(edge)) != NULL)
+
+// Iterates over the added edges that match the query like the edges of `grammar_neighborhood`.
+// The delta must not be changed during the iteration.
+typedef struct {
+	const Delta* d;
+	int query_type;
+	CGraphRank rank;
+	const CGraphNode* nodes;
+
+	const DeltaEdgeList* list; // indices of the candidates, NULL if all edges are candidates
+	size_t pos;
+} DeltaIterator;
+
+void delta_iter(const Delta* d, int query_type, CGraphRank rank, const CGraphNode* nodes, DeltaIterator* it);
+
+// Sets `e` to the next edge, its nodes are the nodes of the added edge and are valid until the delta is changed.
+// Returns false if no further edge exists.
+bool delta_iter_next(DeltaIterator* it, CGraphEdge* e);
+
+#endif
@@ -6,13 +6,46 @@
 #include "edge.h"
 
 #include <stdbool.h>
+#include <stdlib.h>
 #include <reader.h>
 
+void edge_init(StEdge* e) {
+	e->rank = 0;
+	e->cap = 0;
+	e->nodes = NULL;
+}
+
+void edge_destroy(StEdge* e) {
+	free(e->nodes);
+	e->cap = 0;
+	e->nodes = NULL;
+}
+
+int edge_reserve(StEdge* e, int n) {
+	if(n <= e->cap)
+		return 0;
+
+	int cap = e->cap == 0 ? 16 : e->cap;
+	while(cap < n)
+		cap *= 2;
+
+	uint64_t* nodes = realloc(e->nodes, cap * sizeof(*nodes));
+	if(!nodes)
+		return -1;
+
+	e->nodes = nodes;
+	e->cap = cap;
+	return 0;
+}
+
 // works the same as in the Python implementation
-void edge_read(Reader* r, StEdge* e) {
+int edge_read(Reader* r, StEdge* e) {
 	e->label = reader_eliasdelta(r);
 	e->rank = reader_eliasdelta(r);
+	if(e->rank > LIMIT_MAX_RANK || edge_reserve(e, e->rank) < 0)
+		return -1;
 
 	for(int i = 0; i < e->rank; i++)
 		e->nodes[i] = reader_eliasdelta(r);
+	return 0;
 }
@@ -10,16 +10,21 @@
 #include <reader.h>
 #include <constants.h>
 
-// It is assumed that the maximum rank never exceeds 128.
-// This should already be limited by the Python implementation.
-// Since the runtime from decompressing an edge is exponential to its rank, such a high rank should not occur anyway.
-
+// The nodes of an edge are kept in a buffer that grows with the rank of the decoded edges,
+// so an edge only needs as much memory as the highest rank decoded into it.
 typedef struct {
 	uint64_t label;
 	int rank;
-	uint64_t nodes[LIMIT_MAX_RANK]; // memory for a maximum of MAX_RANK edges
+	int cap; // number of nodes that fit into `nodes`
+	uint64_t* nodes;
 } StEdge; // struct edge - in opposite to edge id used in cgraph.h
 
-void edge_read(Reader* r, StEdge* e); // the dst edge is given as a pointer
+void edge_init(StEdge* e);
+void edge_destroy(StEdge* e);
+
+// Ensures that `e->nodes` has space for `n` nodes. Returns 0 on success, otherwise -1.
+int edge_reserve(StEdge* e, int n);
+
+int edge_read(Reader* r, StEdge* e); // the dst edge is given as a pointer
 
 #endif
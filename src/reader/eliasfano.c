@@ -57,9 +57,10 @@ uint64_t eliasfano_get(EliasFanoReader* e, uint64_t i) {
     uint64_t lval = 0;
     if(e->lowbits > 0) {
         FileOff off = e->off_lo + ((FileOff) i) * ((FileOff) e->lowbits); // casting to FileOff because of possible overflow
-        reader_bitpos(&e->r, off);
+        Reader r = e->r;
+        reader_bitpos(&r, off);
 
-        lval = reader_readint(&e->r, e->lowbits);
+        lval = reader_readint(&r, e->lowbits);
     }
 
     uint64_t hval = bitsequence_reader_select1(e->hi, i + 1) - i;
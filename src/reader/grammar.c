@@ -102,9 +102,29 @@ void grammar_neighborhood(GrammarReader* g, int query_type, CGraphRank rank, con
     nb->rank = rank;
     nb->nodes = nodes;
 	nb->g = g;
+	nb->delta = NULL;
+	nb->row = NULL;
 
 	startsymbol_neighborhood(g->start, query_type, rank, nodes, &nb->start);
 	ringqueue_init(&nb->queue, 0);
+	edge_init(&nb->edge);
+	nb->last = NULL;
+}
+
+void grammar_neighborhood_row(GrammarReader* g, const StartSymbolRow* row, int query_type, CGraphRank rank, const CGraphNode* nodes, GrammarNeighborhood* nb) {
+	nb->has_next = true;
+	nb->rank = rank;
+	nb->nodes = nodes;
+	nb->g = g;
+	nb->delta = NULL;
+	nb->row = row;
+	nb->row_pos = 0;
+
+	// only the query type is needed by `decompress`
+	nb->start.query_type = query_type;
+	ringqueue_init(&nb->queue, 0);
+	edge_init(&nb->edge);
+	nb->last = NULL;
 }
 
 static bool hedge_contains(HEdge* e, uint64_t n) {
@@ -114,8 +134,28 @@ static bool hedge_contains(HEdge* e, uint64_t n) {
 	return false;
 }
 
-// This function works by only allocating to the stack.
-// No malloc is used so no memory must be freed.
+// Enqueues an edge of the rule of the non-terminal edge `e`, `idx` are the indices of its nodes in `e`.
+static inline int decompress_enqueue(GrammarNeighborhood* nb, const HEdge* e, uint64_t label, int rank, const uint64_t* idx) {
+	HEdge* enew = malloc(hedge_sizeof(rank));
+	if(!enew)
+		return -1;
+
+	enew->label = label;
+	enew->rank = rank;
+
+	for(int j = 0; j < rank; j++)
+		enew->nodes[j] = e->nodes[idx[j]];
+
+	// adding all new edges to the queue
+	if(ringqueue_enqueue(&nb->queue, enew) < 0) {
+		free(enew);
+		return -1;
+	}
+
+	return 0;
+}
+
+// The edges of the rules are taken from the decoded rules of the rules reader if possible.
 static int decompress(GrammarNeighborhood* nb, HEdge* e, CGraphEdge* res) {
 
 	uint64_t first_nt;
@@ -136,10 +176,10 @@ static int decompress(GrammarNeighborhood* nb, HEdge* e, CGraphEdge* res) {
                 return 0;
         }
 
-        if(res) { // res may be NULL
+        if(res) { // res may be NULL, the nodes are kept as `nb->last` by the caller
             res->rank = e->rank;
             res->label = e->label;
-            memcpy(res->nodes, e->nodes, e->rank * sizeof (CGraphNode));
+            res->nodes = (CGraphNode*) e->nodes;
         }
 
         return 1;
@@ -158,45 +198,87 @@ static int decompress(GrammarNeighborhood* nb, HEdge* e, CGraphEdge* res) {
             return 0;
     }
 
-    StEdge rule[MAX_RULE_SIZE]; // Rule if the non-terminal
-	size_t rlen = rules_get(nb->g->rules, e->label, rule); // load the rule to variable `rule` - already on stack
+	const Rule* rule = rules_decoded(nb->g->rules, e->label);
+	if(rule) {
+		const uint64_t* v = rule->data;
+		for(int i = 0; i < rule->len; i++) {
+			if(decompress_enqueue(nb, e, v[0], v[1], v + 2) < 0)
+				return -1;
+			v += 2 + v[1];
+		}
+		return 0;
+	}
 
-	for(size_t i = 0; i < rlen; i++) {
-		StEdge* ei = rule + i;
+	// the rule is not in the cache, so its edges are read one by one
+	Reader cursor;
+	int rlen = rules_seek(nb->g->rules, e->label, &cursor);
 
-		HEdge* enew = malloc(hedge_sizeof(ei->rank));
-		if(!enew)
+	StEdge* ei = &nb->edge;
+	for(int i = 0; i < rlen; i++) {
+		if(edge_read(&cursor, ei) < 0)
+			return -1;
+		if(decompress_enqueue(nb, e, ei->label, ei->rank, ei->nodes) < 0)
 			return -1;
+	}
+
+	return 0;
+}
+
+// Enqueues a copy of the next edge of the row, that is adjacent to all nodes of the query.
+static int grammar_neighborhood_next_enqueue_row(GrammarNeighborhood* nb) {
+	const StartSymbolRow* row = nb->row;
+	for(; nb->row_pos < row->len; nb->row_pos++) {
+		if(nb->delta && delta_start_edge_removed(nb->delta, row->ids[nb->row_pos]))
+			continue;
 
-		enew->label = ei->label;
-		enew->rank = ei->rank;
+		HEdge* e = row->edges[nb->row_pos];
 
-		for(int j = 0; j < ei->rank; j++)
-			enew->nodes[j] = e->nodes[ei->nodes[j]];
+		bool adjacent = true;
+		for(int i = 0; adjacent && i < nb->rank; i++)
+			adjacent = nb->nodes[i] == CGRAPH_NODES_ALL || hedge_contains(e, nb->nodes[i]);
+		if(!adjacent)
+			continue;
 
-		// adding all new edges to the queue
-		if(ringqueue_enqueue(&nb->queue, enew) < 0)
+		HEdge* edge = malloc(hedge_sizeof(e->rank));
+		if(!edge)
 			return -1;
+		memcpy(edge, e, hedge_sizeof(e->rank));
+
+		if(ringqueue_enqueue(&nb->queue, edge) < 0) {
+			free(edge);
+			return -1;
+		}
+
+		nb->row_pos++;
+		return 1;
 	}
 
 	return 0;
 }
 
 static int grammar_neighborhood_next_enqueue(GrammarNeighborhood* nb) {
-	StEdge e;
-	if(!startsymbol_neighborhood_next(&nb->start, &e))
-		return 0;
+	if(nb->row)
+		return grammar_neighborhood_next_enqueue_row(nb);
 
-	HEdge* edge = malloc(hedge_sizeof(e.rank));
+	StEdge* e = &nb->edge;
+	do {
+		int res = startsymbol_neighborhood_next(&nb->start, e);
+		if(res != 1)
+			return res;
+	} while(nb->delta && delta_start_edge_removed(nb->delta, nb->start.edge_id));
+
+	HEdge* edge = malloc(hedge_sizeof(e->rank));
 	if(!edge)
 		return -1;
 
-	edge->label = e.label;
-	edge->rank = e.rank;
-	memcpy(edge->nodes, e.nodes, e.rank * sizeof(uint64_t));
+	edge->label = e->label;
+	edge->rank = e->rank;
+	memcpy(edge->nodes, e->nodes, e->rank * sizeof(uint64_t));
 
-	if(ringqueue_enqueue(&nb->queue, edge) < 0)
+	if(ringqueue_enqueue(&nb->queue, edge) < 0) {
+		free(edge);
 		return -1;
+	}
 
 	return 1;
 }
@@ -224,28 +306,33 @@ int grammar_neighborhood_next(GrammarNeighborhood* nb, CGraphEdge* n) {
 			HEdge* edge = ringqueue_dequeue(&nb->queue);
 
 			int res = decompress(nb, edge, n);
-			free(edge);
-
-			switch(res) {
-			case 0:
-				break;
-			case 1:
+			if(res == 1) {
+				// the result references the nodes of the edge, so it is kept until the next call
+				free(nb->last);
+				nb->last = edge;
 				return 1;
-			default:
-				return -1;
 			}
+
+			free(edge);
+			if(res < 0)
+				return -1;
 		}
 	}
 }
 
 void grammar_neighborhood_finish(GrammarNeighborhood* nb) {
 	if(nb->has_next) {
-		startsymbol_neighborhood_finish(&nb->start);
+		if(!nb->row)
+			startsymbol_neighborhood_finish(&nb->start);
 
 		while(!ringqueue_empty(&nb->queue))
 			free(ringqueue_dequeue(&nb->queue));
 		ringqueue_destroy(&nb->queue);
 
+		edge_destroy(&nb->edge);
+		free(nb->last);
+		nb->last = NULL;
+
 		nb->has_next = false;
 	}
 }
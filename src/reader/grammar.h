@@ -10,6 +10,10 @@
 #include <reader.h>
 #include <startsymbol.h>
 #include <rules.h>
+#include <delta.h>
+#include <edge.h>
+#include <hgraph.h>
+#include <ringqueue.h>
 
 typedef struct {
 	uint64_t node_count;
@@ -28,16 +32,28 @@ typedef struct {
     const CGraphNode* nodes;
 
 	GrammarReader* g;
+	const Delta* delta; // the removed edges of the start symbol are skipped, NULL if no edges were removed
 	StartSymbolNeighborhood start;
+
+	// If set, the edges of the start symbol are taken from this row instead of `start`.
+	const StartSymbolRow* row;
+	size_t row_pos;
 	RingQueue queue;
+
+	StEdge edge; // edge of the start symbol or of a rule that is currently decoded
+	HEdge* last; // edge returned last, its nodes are referenced by the result of `grammar_neighborhood_next`
 } GrammarNeighborhood;
 
 void grammar_neighborhood(GrammarReader* g, int query_type, CGraphRank rank, const CGraphNode* nodes, GrammarNeighborhood* nb);
+// Like `grammar_neighborhood`, but the edges of the start symbol are the edges of the row.
+// The row must contain the edges at one of the nodes of the query and must not be destroyed during the iteration.
+void grammar_neighborhood_row(GrammarReader* g, const StartSymbolRow* row, int query_type, CGraphRank rank, const CGraphNode* nodes, GrammarNeighborhood* nb);
 
 // return value:
 // 1: next element exists
 // 0: no next element exists
 // -1: error occured
+// The nodes of `n` are set to memory of the neighborhood, which is valid until the next call or `grammar_neighborhood_finish`.
 int grammar_neighborhood_next(GrammarNeighborhood* nb, CGraphEdge* n);
 void grammar_neighborhood_finish(GrammarNeighborhood* nb); // needed if not iterated to the end
 
@@ -9,7 +9,6 @@
 #include <arith.h>
 #include <reader.h>
 #include <bitsequence_r.h>
-#include <ringqueue.h>
 
 K2Reader* k2_init(Reader* r) {
 	size_t nbytes;
@@ -69,6 +68,13 @@ void k2_destroy(K2Reader* k) {
 	free(k);
 }
 
+// Reads a bit of the leaves. The reader is copied, so the matrix is not modified by queries.
+static inline bool k2_leaf(const K2Reader* k, uint64_t i) {
+	Reader r = k->l;
+	reader_bitpos(&r, i);
+	return reader_readbit(&r);
+}
+
 bool k2_get(K2Reader* k, uint64_t r, uint64_t c) {
 	if(r >= k->height || c >= k->width)
 		return false;
@@ -81,194 +87,242 @@ bool k2_get(K2Reader* k, uint64_t r, uint64_t c) {
 	uint64_t x = k->k * (r / n) + c / n;
 
 	while(x < bitsequence_reader_len(k->t)) {
-		if(!bitsequence_reader_access(k->t, x))
+		uint64_t rank;
+		if(!bitsequence_reader_access_rank1(k->t, x, &rank))
 			return false;
 
 		n /= k->k;
 
-		x = bitsequence_reader_rank1(k->t, x) * (k->k * k->k) + k->k * (p / n) + q / n;
+		x = rank * (k->k * k->k) + k->k * (p / n) + q / n;
 
 		p %= n;
 		q %= n;
 	}
 
-	reader_bitpos(&k->l, x - bitsequence_reader_len(k->t));
-	return reader_readbit(&k->l);
+	return k2_leaf(k, x - bitsequence_reader_len(k->t));
 }
 
 typedef struct {
-	size_t len;
-	size_t cap;
-	uint64_t* data;
-} IntList;
-
-// low level uint64_t list with capacity
-// used for the direct and reverse operations
-int int_append(IntList* l, uint64_t i) {
-	size_t cap = l->cap;
-
-	if(cap == l->len) {
-		cap = !cap ? 16 : (cap + (cap >> 1)); // default cap is 16 because the default rank is limited to 12
-		uint64_t* data = realloc(l->data, cap * sizeof(*data));
-		if(!data)
-			return -1;
+	uint64_t n; // size of the submatrices of the children
+	uint64_t off; // first row of the submatrix of the node
+	uint64_t q; // column inside the submatrix of the node
+	uint64_t y; // position of the first child in T or L that intersects the column
+	int pos; // next row of the node in `rows`
+	int end; // end of the rows of the node in `rows`
+} K2RowsLevel;
+
+bool k2_get_rows(K2Reader* k, const uint64_t* rows, int len, uint64_t c) {
+	if(len == 0)
+		return true;
+	if(c >= k->width || rows[len - 1] >= k->height)
+		return false;
+	if(!k->t)
+		return false;
+
+	uint64_t len_t = bitsequence_reader_len(k->t);
+
+	// The tree is descended depth first along the column, only children that contain one of the rows are visited.
+	K2RowsLevel stack[K2_MAX_DEPTH];
+	int depth = 1;
+
+	stack[0].n = k->n / k->k;
+	stack[0].off = 0;
+	stack[0].q = c;
+	stack[0].y = c / stack[0].n;
+	stack[0].pos = 0;
+	stack[0].end = len;
+
+	while(depth > 0) {
+		K2RowsLevel* l = &stack[depth - 1];
+		if(l->pos == l->end) {
+			depth--;
+			continue;
+		}
+
+		// the rows of the child are the following rows that are in the same band of the node
+		uint64_t j = (rows[l->pos] - l->off) / l->n;
+		uint64_t off = l->off + l->n * j;
+		int start = l->pos;
+		while(l->pos < l->end && rows[l->pos] < off + l->n)
+			l->pos++;
+
+		uint64_t x = l->y + j * k->k;
+		if(x >= len_t) {
+			if(!k2_leaf(k, x - len_t))
+				return false;
+			continue;
+		}
+
+		uint64_t rank;
+		if(!bitsequence_reader_access_rank1(k->t, x, &rank))
+			return false;
 
-		l->cap = cap;
-		l->data = data;
+		K2RowsLevel* child = &stack[depth++];
+		child->n = l->n / k->k;
+		child->off = off;
+		child->q = l->q % l->n;
+		child->y = rank * (k->k * k->k) + child->q / child->n;
+		child->pos = start;
+		child->end = l->pos;
 	}
 
-	l->data[l->len++] = i;
-	return 0;
+	return true;
 }
 
 // x is signed because it can be -1
-static int k2reverse(K2Reader* k, uint64_t n, uint64_t q, uint64_t p, int64_t x, IntList* l) {
-	if(p >= k->height)
+static int k2cells(K2Reader* k, uint64_t n, uint64_t p, uint64_t q, int64_t x, K2CellCallback cb, void* ctx) {
+	if(p >= k->height || q >= k->width)
 		return 0;
 	if(x >= (int64_t) bitsequence_reader_len(k->t)) { // Warning: comparing signed values
-		reader_bitpos(&k->l, x - bitsequence_reader_len(k->t));
-		if(reader_readbit(&k->l))
-			if(int_append(l, p) < 0)
-				return -1;
+		if(k2_leaf(k, x - bitsequence_reader_len(k->t)))
+			return cb(p, q, ctx);
 	}
 	else {
-		if(x == -1 || bitsequence_reader_access(k->t, x)) {
+		uint64_t rank = 0; // rank1(-1) is 0
+		if(x == -1 || bitsequence_reader_access_rank1(k->t, x, &rank)) {
 			uint64_t nnew = n / k->k;
-			uint64_t y = bitsequence_reader_rank1(k->t, x) * (k->k * k->k) + (q / nnew);
+			uint64_t y = rank * (k->k * k->k);
 
-			for(int j = 0; j < k->k; j++)
-				if(k2reverse(k, nnew, q % nnew, p + nnew * j, y + j * k->k, l) < 0)
-					return -1;
+			for(int i = 0; i < k->k; i++)
+				for(int j = 0; j < k->k; j++)
+					if(k2cells(k, nnew, p + nnew * i, q + nnew * j, y + i * k->k + j, cb, ctx) < 0)
+						return -1;
 		}
 	}
 	return 0;
 }
 
-uint64_t* k2_column(K2Reader* k, uint64_t q, size_t* l) {
-	if(q < 0 || q >= k->width) {
-		*l = 0;
-		return NULL;
-	}
-	if(!k->t) {
-		*l = 0;
-		return NULL;
-	}
-
-	IntList li = {0}; // initializing with zeros
-	if(k2reverse(k, k->n, q, 0, -1, &li) < 0)
-		return NULL;
+int k2_cells(K2Reader* k, K2CellCallback cb, void* ctx) {
+	if(!k->t)
+		return 0;
 
-	*l = li.len; // our list li has a capacity but we ignore it. just using len :)
-	return li.data;
+	return k2cells(k, k->n, 0, 0, -1, cb, ctx);
 }
 
-typedef struct {
-	uint64_t n;
-	uint64_t p;
-	uint64_t q;
-	int64_t x;
-} K2IteratorElement;
+// Sets the position of the first child of the level `l` in T or L that intersects the i-th row / column,
+// `rank` is rank1 of the position of the node in T.
+static inline void k2_iter_children(const K2Iterator* it, K2IteratorLevel* l, int i, uint64_t rank) {
+	uint64_t k = it->k->k;
+	uint64_t band = (it->v[i] / l->n) % k; // child that contains the row / column
+	l->y[i] = rank * (k * k) + (it->row ? k * band : band);
+}
 
-static void k2_iter_init(K2Reader* k, uint64_t v, bool row, K2Iterator* it) {
+static void k2_iter_init(K2Reader* k, const uint64_t* v, int len, bool row, K2Iterator* it) {
 	it->k = k;
 	it->row = row;
-	it->has_next = false; // set it to true if the element could be added to the queue
+	it->len = len;
+	it->depth = 0;
+	it->has_next = false; // set it to true if the root could be added to the stack
 
-	if(k->t) {
-		ringqueue_init(&it->queue, MIN(k->height, 16));
+	if(!k->t || len < 1 || len > K2_MAX_ROWS)
+		return;
 
-		K2IteratorElement* l = malloc(sizeof(*l));
-		if(!l)
-			return;
+	K2IteratorLevel* l = &it->stack[0];
+	l->n = k->n / k->k;
+	l->off = 0;
+	l->j = 0;
 
-		l->n = k->n;
-		l->x = -1;
-
-		if(row) {
-			l->p = v;
-			l->q = 0;
-		}
-		else {
-			l->p = 0;
-			l->q = v;
-		}
-
-		if(ringqueue_enqueue(&it->queue, l) < 0)
+	for(int i = 0; i < len; i++) {
+		if(v[i] >= (row ? k->height : k->width))
 			return;
 
-		it->has_next = true;
+		it->v[i] = v[i];
+		k2_iter_children(it, l, i, bitsequence_reader_rank1(k->t, -1));
 	}
+
+	it->depth = 1;
+	it->has_next = true;
 }
 
 void k2_iter_init_row(K2Reader* k, uint64_t p, K2Iterator* it) {
-	k2_iter_init(k, p, true, it);
+	k2_iter_init(k, &p, 1, true, it);
 }
 
-static int k2_iter_next_element(K2Iterator* it, uint64_t* v) {
-	int res = 0;
-	while(!ringqueue_empty(&it->queue) && res != 1) {
-		K2IteratorElement* l = ringqueue_dequeue(&it->queue);
+void k2_iter_init_rows(K2Reader* k, const uint64_t* rows, int len, K2Iterator* it) {
+	k2_iter_init(k, rows, len, true, it);
+}
 
-		// check if width / height reached
-		if(it->row) {
-			if(l->q >= it->k->width)
-				goto loop_continue;
-		}
-		else {
-			if(l->p >= it->k->height)
-				goto loop_continue;
+// The tree is traversed depth first with the children in ascending order, so the values are returned in
+// ascending order. Each level of the stack is a node of the tree whose children are currently visited.
+// A child is only visited if it is set for all rows / columns of the iterator. If `max_depth` is reached,
+// the first value of the set nodes is returned instead of visiting their children.
+static int k2_iter_step(K2Iterator* it, int max_depth, uint64_t* v) {
+	K2Reader* k = it->k;
+	uint64_t len_t = bitsequence_reader_len(k->t);
+	uint64_t limit = it->row ? k->width : k->height;
+
+	while(it->depth > 0) {
+		K2IteratorLevel* l = &it->stack[it->depth - 1];
+
+		// the children are in ascending order, so if one exceeds the width / height all following do as well
+		uint64_t c = l->off + l->n * l->j;
+		if(l->j == k->k || c >= limit) {
+			it->depth--;
+			continue;
 		}
 
-		if(l->x >= (int64_t) bitsequence_reader_len(it->k->t)) { // Warning: comparing signed values
-			reader_bitpos(&it->k->l, l->x - bitsequence_reader_len(it->k->t));
-			if(reader_readbit(&it->k->l)) {
-				*v = it->row ? l->q : l->p;
-				res = 1;
-				goto loop_continue;
+		uint64_t step = it->row ? l->j : l->j * k->k;
+		l->j++;
+
+		// all nodes of a level are either leaves or not
+		if(l->y[0] + step >= len_t) {
+			bool set = true;
+			for(int i = 0; i < it->len && set; i++)
+				set = k2_leaf(k, l->y[i] + step - len_t);
+
+			if(set) {
+				*v = c;
+				return 1;
 			}
+			continue;
 		}
-		else {
-			if(l->x == -1 || bitsequence_reader_access(it->k->t, l->x)) {
-				uint64_t k = it->k->k;
-				uint64_t nnew = l->n / k;
-
-				uint64_t y = bitsequence_reader_rank1(it->k->t, l->x) * (k * k);
-				if(it->row)
-					y += k * (l->p / nnew);
-				else
-					y += l->q / nnew;
-
-				for(int j = 0; j < k; j++) {
-					K2IteratorElement* el = malloc(sizeof(*el));
-					if(!el) {
-						res = -1;
-						goto loop_continue;
-					}
-
-					el->n = nnew;
-					if(it->row) {
-						el->p = l->p % nnew;
-						el->q = l->q + nnew * j;
-						el->x = y + j;
-					}
-					else {
-						el->p = l->p + nnew * j;
-						el->q = l->q % nnew;
-						el->x = y + j * k;
-					}
-
-					if(ringqueue_enqueue(&it->queue, el) < 0) {
-						// TODO: goto und free
-					}
-				}
-			}
+
+		uint64_t rank[K2_MAX_ROWS];
+		bool set = true;
+		for(int i = 0; i < it->len && set; i++)
+			set = bitsequence_reader_access_rank1(k->t, l->y[i] + step, &rank[i]);
+		if(!set)
+			continue;
+
+		if(it->depth == max_depth) {
+			*v = c;
+			return 1;
 		}
 
-loop_continue:
-		free(l);
+		K2IteratorLevel* child = &it->stack[it->depth++];
+		child->n = l->n / k->k;
+		child->off = c;
+		child->j = 0;
+		for(int i = 0; i < it->len; i++)
+			k2_iter_children(it, child, i, rank[i]);
 	}
 
-	return res;
+	return 0;
+}
+
+static inline int k2_iter_next_element(K2Iterator* it, uint64_t* v) {
+	return k2_iter_step(it, K2_MAX_DEPTH, v);
+}
+
+// The set nodes of the row are counted on the first level that splits the width of the matrix into at least
+// this number of nodes. The count is small for rows with few cells and large for dense rows.
+#define K2_ESTIMATE_NODES 64
+
+uint64_t k2_row_estimate(K2Reader* k, uint64_t r) {
+	K2Iterator it;
+	k2_iter_init(k, &r, 1, true, &it);
+	if(!it.has_next)
+		return 0;
+
+	int depth = 1;
+	for(uint64_t n = k->n / k->k; n > 1 && k->width / n < K2_ESTIMATE_NODES; n /= k->k)
+		depth++;
+
+	uint64_t count = 0;
+	uint64_t v;
+	while(k2_iter_step(&it, depth, &v) == 1)
+		count++;
+	return count;
 }
 
 int k2_iter_next(K2Iterator* it, uint64_t* v) {
@@ -285,10 +339,22 @@ int k2_iter_next(K2Iterator* it, uint64_t* v) {
 }
 
 void k2_iter_finish(K2Iterator* it) {
-	if(it->has_next) {
-		while(!ringqueue_empty(&it->queue))
-			free(ringqueue_dequeue(&it->queue));
-		ringqueue_destroy(&it->queue);
-		it->has_next = false;
+	it->depth = 0;
+	it->has_next = false;
+}
+
+int64_t k2_column(K2Reader* k, uint64_t q, uint64_t* col, size_t cap) {
+	K2Iterator it;
+	k2_iter_init(k, &q, 1, false, &it);
+	if(!it.has_next)
+		return 0;
+
+	size_t len = 0;
+	uint64_t v;
+	while(k2_iter_next_element(&it, &v) == 1) {
+		if(len == cap)
+			return -1;
+		col[len++] = v;
 	}
+	return len;
 }
@@ -7,7 +7,11 @@
 #define K2TREE_H
 
 #include <bitsequence_r.h>
-#include <ringqueue.h>
+
+// maximum depth of a tree, the size n = k^depth of the matrix is a uint64_t and k is at least 2
+#define K2_MAX_DEPTH 64
+// maximum number of rows of an iterator over the intersection of rows
+#define K2_MAX_ROWS 8
 
 typedef struct {
 	uint64_t width;
@@ -23,19 +27,47 @@ K2Reader* k2_init(Reader* r);
 void k2_destroy(K2Reader* k);
 
 bool k2_get(K2Reader* k, uint64_t r, uint64_t c);
+// Returns true if the cells of all `rows` in the column `c` are set. The rows must be sorted in ascending order.
+// In contrast to calling `k2_get` for each row, the tree is only descended once and the common nodes are shared.
+bool k2_get_rows(K2Reader* k, const uint64_t* rows, int len, uint64_t c);
+
+// Writes the rows of the set cells of the column `q` in ascending order to `col`. The column can be determined
+// via a regular function because the number of elements is limited to the rank of the compression.
+// Returns the number of rows or -1 if the column has more than `cap` rows.
+int64_t k2_column(K2Reader* k, uint64_t q, uint64_t* col, size_t cap);
+
+typedef int (*K2CellCallback)(uint64_t r, uint64_t c, void* ctx);
 
-// The column can be determined via a regular function because the number of elements in the pointer
-// are limited to the rank of the compression.
-uint64_t* k2_column(K2Reader* k, uint64_t q, size_t* l);
+// Calls `cb` for every set cell of the matrix in one traversal of the tree.
+// The cells are visited in the order of the tree, so neither by rows nor by columns.
+// If `cb` returns a negative value, the traversal is stopped and -1 is returned, otherwise 0.
+int k2_cells(K2Reader* k, K2CellCallback cb, void* ctx);
 
+typedef struct {
+	uint64_t n; // size of the submatrices of the children
+	uint64_t off; // first column / row of the submatrix of the node
+	uint64_t y[K2_MAX_ROWS]; // position of the first child in T or L that intersects each row / column
+	int j; // next child
+} K2IteratorLevel;
+
+// The iterator does not allocate any memory, the path from the root to the current node is kept in `stack`.
 typedef struct {
 	K2Reader* k;
 	bool row;
 	bool has_next;
-	RingQueue queue;
+	int len; // number of rows / columns
+	uint64_t v[K2_MAX_ROWS];
+	int depth;
+	K2IteratorLevel stack[K2_MAX_DEPTH];
 } K2Iterator;
 
 void k2_iter_init_row(K2Reader* k, uint64_t p, K2Iterator* it);
+// Iterates over the columns that are set in all `len` rows, at most K2_MAX_ROWS rows are supported.
+// Only the subtrees that are set for all rows are visited, so the work depends on the sparsest row.
+void k2_iter_init_rows(K2Reader* k, const uint64_t* rows, int len, K2Iterator* it);
+
+// Estimates the number of cells in the row by the upper levels of the tree, the estimation is cheap for sparse rows.
+uint64_t k2_row_estimate(K2Reader* k, uint64_t r);
 
 // return value:
 // 1: next element exists
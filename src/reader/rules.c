@@ -43,29 +43,84 @@ RulesReader* rules_init(Reader* r) {
 	rr->table = table;
 	rr->off_rules = 8 * offdata;
 
+	// The cache is disabled if the table of the rules alone exceeds the memory of the cache.
+	rr->cache.size = rule_count * sizeof(Rule*);
+	rr->cache.full = rr->cache.size > RULES_CACHE_SIZE;
+	rr->cache.rules = rr->cache.full ? NULL : calloc(rule_count, sizeof(Rule*));
+
 	return rr;
 }
 
 void rules_destroy(RulesReader* r) {
+	if(r->cache.rules) {
+		for(uint64_t i = 0; i < r->rule_count; i++)
+			free(r->cache.rules[i]);
+		free(r->cache.rules);
+	}
 	eliasfano_destroy(r->table);
 	free(r);
 }
 
-int rules_get(RulesReader* r, uint64_t nt, StEdge* e) {
+int rules_seek(RulesReader* r, uint64_t nt, Reader* cursor) {
 	uint64_t i = nt - r->first_nt;
 	if(i < 0 || i >= r->rule_count)
 		panic("no rule found for non-terminal %" PRIu64, nt);
 
 	FileOff bitoff = eliasfano_get(r->table, i);
-	reader_bitpos(&r->r, r->off_rules + bitoff);
+	*cursor = r->r;
+	reader_bitpos(cursor, r->off_rules + bitoff);
 
-	int num_edges = reader_eliasdelta(&r->r);
+	return reader_eliasdelta(cursor);
+}
 
-	if(num_edges > MAX_RULE_SIZE) // panic because we only have memory for MAX_RULE_SIZE edges :(
-		panic("rule with %d edges found but expected a maximum of %d", num_edges, MAX_RULE_SIZE);
+const Rule* rules_decoded(RulesReader* r, uint64_t nt) {
+	uint64_t i = nt - r->first_nt;
+	if(!r->cache.rules || i >= r->rule_count)
+		return NULL;
+
+	Rule* rule = __atomic_load_n(&r->cache.rules[i], __ATOMIC_ACQUIRE);
+	if(rule || __atomic_load_n(&r->cache.full, __ATOMIC_RELAXED))
+		return rule;
+
+	Reader cursor;
+	int num_edges = rules_seek(r, nt, &cursor);
+
+	// the first pass determines the number of values of the decoded rule
+	Reader c = cursor;
+	size_t len = 0;
+	for(int j = 0; j < num_edges; j++) {
+		reader_eliasdelta(&c); // label
+		int rank = reader_eliasdelta(&c);
+		for(int k = 0; k < rank; k++)
+			reader_eliasdelta(&c);
+		len += 2 + rank;
+	}
+
+	size_t size = sizeof(Rule) + len * sizeof(uint64_t);
+	if(__atomic_add_fetch(&r->cache.size, size, __ATOMIC_RELAXED) > RULES_CACHE_SIZE) {
+		__atomic_store_n(&r->cache.full, true, __ATOMIC_RELAXED);
+		goto err_0;
+	}
+
+	rule = malloc(size);
+	if(!rule)
+		goto err_0;
+
+	rule->len = num_edges;
+	for(size_t j = 0; j < len; j++)
+		rule->data[j] = reader_eliasdelta(&cursor);
+
+	// another thread may have decoded the rule at the same time, then its rule is used
+	Rule* expected = NULL;
+	if(!__atomic_compare_exchange_n(&r->cache.rules[i], &expected, rule, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(rule);
+		__atomic_sub_fetch(&r->cache.size, size, __ATOMIC_RELAXED);
+		return expected;
+	}
 
-	for(int j = 0; j < num_edges; j++)
-		edge_read(&r->r, e + j);
+	return rule;
 
-	return num_edges;
+err_0:
+	__atomic_sub_fetch(&r->cache.size, size, __ATOMIC_RELAXED);
+	return NULL;
 }
@@ -10,12 +10,15 @@
 #include <eliasfano.h>
 #include <edge.h>
 
-// We expect, that in large compressed graphs, we sometimes get inlined rules,
-// so the number of edges in a rule exceeds 2.
-// In own tests with LARGE graphs which took hours to compress, I got a few rules with 28 edges.
-// But this value never exceeded.
-// So the maximum number of edges in a rule is limited to (MAX_RANK / 2) = 64.
-#define MAX_RULE_SIZE (LIMIT_MAX_RANK / 2)
+// Maximum memory of the decoded rules kept by a RulesReader in bytes, including the table of the rules.
+#define RULES_CACHE_SIZE ((size_t) 256 << 20)
+
+// Decoded rule, the edges are stored one after another as label, rank and the indices of the nodes
+// in the non-terminal edge.
+typedef struct {
+	int len; // number of edges
+	uint64_t data[];
+} Rule;
 
 typedef struct {
 	Reader r;
@@ -23,11 +26,25 @@ typedef struct {
 	uint64_t rule_count;
 	EliasFanoReader* table;
 	FileOff off_rules;
+
+	// The rules are decoded on their first use and kept until the reader is destroyed.
+	// If RULES_CACHE_SIZE is exceeded, no further rules are added.
+	struct {
+		Rule** rules; // decoded rule of each non-terminal, NULL if not decoded yet; NULL if the cache is disabled
+		size_t size; // memory used by the cache
+		bool full;
+	} cache;
 } RulesReader;
 
 RulesReader* rules_init(Reader* r);
 void rules_destroy(RulesReader* r);
 
-int rules_get(RulesReader* r, uint64_t nt, StEdge* e);
+// Returns the decoded rule of `nt` or NULL if the rule could not be added to the cache.
+// The rule is valid until the reader is destroyed, the function can be called by several threads.
+const Rule* rules_decoded(RulesReader* r, uint64_t nt);
+
+// Moves the reader `cursor` to the edges of the rule of `nt` and returns the number of its edges.
+// The edges are read one by one with `edge_read(cursor, e)` afterwards.
+int rules_seek(RulesReader* r, uint64_t nt, Reader* cursor);
 
 #endif
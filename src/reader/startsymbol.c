@@ -6,11 +6,13 @@
 #include "startsymbol.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <reader.h>
 #include <cgraph.h>
 #include <panic.h>
 #include <eliasfano.h>
 #include <k2.h>
+#include <arith.h>
 
 StartSymbolReader* startsymbol_init(Reader* r) {
 	size_t nbytes;
@@ -111,10 +113,47 @@ void startsymbol_neighborhood(StartSymbolReader* s, int query_type, CGraphRank r
         n->rank = CGRAPH_NODES_ALL;
     }
     n->query_type = query_type;
+
+	// the bound nodes, for a row query ordered by their estimated degree
+	uint64_t bound[128];
+	uint64_t degree[128];
+	int len = 0;
+	bool row_query = query_type == CGRAPH_EXACT_QUERY || query_type == CGRAPH_CONTAINS_QUERY;
+	int distinct = 0;
+	for(int i = 0; i < n->rank; i++)
+		distinct += n->nodes[i] != CGRAPH_NODES_ALL;
+
+	for(int i = 0; i < n->rank; i++) {
+		if(n->nodes[i] == CGRAPH_NODES_ALL)
+			continue;
+
+		// insertion sort, a query has only a few nodes
+		uint64_t v = n->nodes[i];
+		uint64_t d = row_query && distinct > 1 ? k2_row_estimate(s->matrix, v) : 0;
+		int j = len++;
+		for(; j > 0 && degree[j - 1] > d; j--) {
+			bound[j] = bound[j - 1];
+			degree[j] = degree[j - 1];
+		}
+		bound[j] = v;
+		degree[j] = d;
+	}
+
+	// The rows of the sparsest nodes are intersected by the iterator, the remaining nodes are checked for each edge.
+	int first = row_query ? MIN(len, K2_MAX_ROWS) : 0;
+	n->rows_len = 0;
+	for(int i = first; i < len; i++) {
+		uint64_t v = bound[i];
+		int j = n->rows_len++;
+		for(; j > 0 && n->rows[j - 1] > v; j--)
+			n->rows[j] = n->rows[j - 1];
+		n->rows[j] = v;
+	}
+
     switch (query_type)
     {
         case CGRAPH_EXACT_QUERY: case CGRAPH_CONTAINS_QUERY:
-            k2_iter_init_row(s->matrix, n->nodes[0], &n->it);
+            k2_iter_init_rows(s->matrix, bound, first, &n->it);
             break;
 //        case CGRAPH_PREDICATE_QUERY:
 //            eliasfano_iter(s->labels, label, s->terminals, &n->efit);
@@ -130,28 +169,51 @@ void startsymbol_neighborhood(StartSymbolReader* s, int query_type, CGraphRank r
 // return the id if the index function of a edge
 static inline int edge_ifs_get(StartSymbolReader* s, uint64_t edge) {
 	FileOff line_off = s->edge_ifs.off + s->edge_ifs.n * edge;
-	reader_bitpos(&s->r, line_off);
+	Reader r = s->r;
+	reader_bitpos(&r, line_off);
 
-	return reader_readint(&s->r, s->edge_ifs.n);
+	return reader_readint(&r, s->edge_ifs.n);
 }
 
-// determine the index function of a edge
-// the memory where the index function is written to is given as a parameter
-// the number of elements is returned as the return type
-static inline int if_get(StartSymbolReader* s, int i, int* indf) {
+// Moves the reader `r` to the values of the index function `i` and returns its length,
+// the values are read one by one with `reader_eliasdelta` afterwards.
+static inline int if_seek(StartSymbolReader* s, int i, Reader* r) {
 	FileOff off = eliasfano_get(s->ifs.table, i);
-	reader_bitpos(&s->r, s->ifs.off + off);
+	*r = s->r;
+	reader_bitpos(r, s->ifs.off + off);
 
-	int n = reader_eliasdelta(&s->r);
+	int n = reader_eliasdelta(r);
 	if(n > LIMIT_MAX_RANK)
 		panic("index function %d with a rank of %d exceeds the maximum rank of %d", i, n, LIMIT_MAX_RANK);
 
-	for(int k = 0; k < n; k++)
-		indf[k] = reader_eliasdelta(&s->r);
-
 	return n;
 }
 
+int startsymbol_edge(StartSymbolReader* s, uint64_t e, StEdge* edge) {
+	Reader r;
+	int i_len = if_seek(s, edge_ifs_get(s, e), &r); // length of the index function
+
+	// The column contains each node of the edge once, so it has at most as many nodes as the index function.
+	// It is decoded behind the nodes of the edge, which are then taken from it by the index function.
+	if(edge_reserve(edge, 2 * i_len) < 0)
+		return -1;
+
+	uint64_t* col = edge->nodes + i_len;
+	int64_t c_len = k2_column(s->matrix, e, col, i_len); // Number of nodes of the edge
+	if(c_len < 0)
+		return -1;
+
+	for(int j = 0; j < i_len; j++) {
+		uint64_t idx = reader_eliasdelta(&r);
+		if(idx >= (uint64_t) c_len)
+			return -1;
+		edge->nodes[j] = col[idx];
+	}
+	edge->label = eliasfano_get(s->labels, e);
+	edge->rank = i_len;
+	return 0;
+}
+
 // return value:
 // 1: edge should be considered
 // 0: edge can be ignored
@@ -159,10 +221,6 @@ static inline int if_get(StartSymbolReader* s, int i, int* indf) {
 static inline int get_edge(StartSymbolNeighborhood* n, uint64_t e, StEdge* edge) {
 	StartSymbolReader* s = n->s;
 
-	// determining the label of the edge
-	uint64_t label = eliasfano_get(s->labels, e);
-
-
 //	if((expected_label = n->label) != CGRAPH_LABELS_ALL) {
 //		uint64_t terminals = s->terminals;
 //
@@ -178,29 +236,11 @@ static inline int get_edge(StartSymbolNeighborhood* n, uint64_t e, StEdge* edge)
 //		}
 //	}
 
-	// Check if the current edge is adjacent to all destination nodes.
-    for (int i = 0; i < n->rank; i++) {
-        // edge is not adjacent to the destination node
-        if (n->nodes[i] != CGRAPH_NODES_ALL && !k2_get(s->matrix, n->nodes[i], e))
-            return 0;
-    }
-
-	size_t c_len; // Number of nodes of the edge
-	uint64_t* nodes = k2_column(s->matrix, e, &c_len); // Should we check for NULL?
-	if(!nodes)
-		return -1;
-
-	int ix = edge_ifs_get(s, e); // Index of the index function
-
-	int indx[LIMIT_MAX_RANK]; // The index function
-	int i_len = if_get(s, ix, indx); // length of the index function
+	// Check if the current edge is adjacent to all destination nodes, all nodes are checked in one descent of the matrix.
+	if(n->rows_len > 0 && !k2_get_rows(s->matrix, n->rows, n->rows_len, e))
+		return 0;
 
-	for(int j = 0; j < i_len; j++)
-        edge->nodes[j] = nodes[indx[j]];
-	free(nodes);
-	edge->label = label;
-	edge->rank = i_len;
-	return 1;
+	return startsymbol_edge(s, e, edge) < 0 ? -1 : 1;
 }
 
 int startsymbol_neighborhood_next(StartSymbolNeighborhood* n, StEdge* edge) {
@@ -228,6 +268,7 @@ int startsymbol_neighborhood_next(StartSymbolNeighborhood* n, StEdge* edge) {
                 case 0:
                     continue;
                 case 1:
+                    n->edge_id = neigh;
                     return 1;
                 default:
                     return -1;
@@ -254,6 +295,103 @@ void startsymbol_neighborhood_finish(StartSymbolNeighborhood* n) {
     }
 }
 
+typedef struct {
+	uint64_t edges;
+	uint64_t* ends; // end of the rows of each column in `rows`, the start while counting
+	uint64_t* rows;
+} StartSymbolColumns;
+
+static int startsymbol_count_cell(uint64_t r, uint64_t c, void* ctx) {
+	(void) r; // only the columns are counted
+	StartSymbolColumns* cols = ctx;
+	if(c >= cols->edges)
+		return -1;
+	cols->ends[c]++;
+	return 0;
+}
+
+static int startsymbol_add_cell(uint64_t r, uint64_t c, void* ctx) {
+	StartSymbolColumns* cols = ctx;
+	cols->rows[cols->ends[c]++] = r;
+	return 0;
+}
+
+int startsymbol_edges(StartSymbolReader* s, StartSymbolEdgeCallback cb, void* ctx) {
+	uint64_t edges = s->labels->n;
+	int res = -1;
+
+	StartSymbolColumns cols;
+	cols.edges = edges;
+	cols.ends = calloc(edges + 1, sizeof(*cols.ends));
+	if(!cols.ends)
+		return -1;
+
+	// The first traversal counts the nodes of each column, the second one adds them,
+	// afterwards `ends[e]` is the end of the column `e` and the start of the next one.
+	if(k2_cells(s->matrix, startsymbol_count_cell, &cols) < 0)
+		goto exit_0;
+
+	uint64_t sum = 0;
+	for(uint64_t e = 0; e < edges; e++) {
+		uint64_t c = cols.ends[e];
+		cols.ends[e] = sum;
+		sum += c;
+	}
+
+	cols.rows = malloc(MAX(sum, 1) * sizeof(*cols.rows));
+	if(!cols.rows)
+		goto exit_0;
+
+	if(k2_cells(s->matrix, startsymbol_add_cell, &cols) < 0)
+		goto exit_1;
+
+	StEdge edge;
+	edge_init(&edge);
+
+	uint64_t start = 0;
+	for(uint64_t e = 0; e < edges; e++) {
+		uint64_t* nodes = cols.rows + start;
+		uint64_t len = cols.ends[e] - start;
+		start = cols.ends[e];
+
+		// The nodes are sorted like the column of `k2_column`, a column contains only a few nodes.
+		for(uint64_t i = 1; i < len; i++) {
+			uint64_t v = nodes[i];
+			uint64_t j = i;
+			for(; j > 0 && nodes[j - 1] > v; j--)
+				nodes[j] = nodes[j - 1];
+			nodes[j] = v;
+		}
+
+		Reader r;
+		int i_len = if_seek(s, edge_ifs_get(s, e), &r);
+		if(edge_reserve(&edge, i_len) < 0)
+			goto exit_2;
+
+		for(int j = 0; j < i_len; j++) {
+			uint64_t idx = reader_eliasdelta(&r);
+			if(idx >= len)
+				goto exit_2;
+			edge.nodes[j] = nodes[idx];
+		}
+		edge.label = eliasfano_get(s->labels, e);
+		edge.rank = i_len;
+
+		if(cb(&edge, ctx) < 0)
+			goto exit_2;
+	}
+
+	res = 0;
+
+exit_2:
+	edge_destroy(&edge);
+exit_1:
+	free(cols.rows);
+exit_0:
+	free(cols.ends);
+	return res;
+}
+
 void startsymbol_iter(uint64_t edge_count, StartSymbolIterator* it) {
     it->edge_count = edge_count;
     it->edge_id = 0;
@@ -282,3 +420,72 @@ void startsymbol_finish(StartSymbolIterator * it) {
         it->has_next = false;
     }
 }
+
+int startsymbol_row(StartSymbolReader* s, uint64_t node, StartSymbolRow* row) {
+	row->len = 0;
+	row->ids = NULL;
+	row->edges = NULL;
+
+	size_t cap = 0;
+
+	StEdge edge;
+	edge_init(&edge);
+
+	K2Iterator it;
+	k2_iter_init_row(s->matrix, node, &it);
+
+	uint64_t e;
+	int res;
+	while((res = k2_iter_next(&it, &e)) == 1) {
+		if(row->len == cap) {
+			cap = cap == 0 ? 8 : 2 * cap;
+			uint64_t* ids = realloc(row->ids, cap * sizeof(*ids));
+			if(!ids)
+				goto err_0;
+			row->ids = ids;
+
+			HEdge** edges = realloc(row->edges, cap * sizeof(*edges));
+			if(!edges)
+				goto err_0;
+			row->edges = edges;
+		}
+
+		if(startsymbol_edge(s, e, &edge) < 0)
+			goto err_0;
+
+		HEdge* h = malloc(hedge_sizeof(edge.rank));
+		if(!h)
+			goto err_0;
+
+		h->label = edge.label;
+		h->rank = edge.rank;
+		memcpy(h->nodes, edge.nodes, edge.rank * sizeof(uint64_t));
+
+		row->ids[row->len] = e;
+		row->edges[row->len] = h;
+		row->len++;
+	}
+
+	if(res < 0)
+		goto err_1;
+
+	edge_destroy(&edge);
+	return 0;
+
+err_0:
+	k2_iter_finish(&it);
+err_1:
+	edge_destroy(&edge);
+	startsymbol_row_destroy(row);
+	return -1;
+}
+
+void startsymbol_row_destroy(StartSymbolRow* row) {
+	for(size_t i = 0; i < row->len; i++)
+		free(row->edges[i]);
+	free(row->edges);
+	free(row->ids);
+	row->len = 0;
+	row->ids = NULL;
+	row->edges = NULL;
+}
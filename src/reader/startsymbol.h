@@ -12,6 +12,7 @@
 #include <eliasfano.h>
 #include <k2.h>
 #include <cgraph.h>
+#include <hgraph.h>
 
 typedef struct {
     uint64_t edge_count;
@@ -58,8 +59,12 @@ typedef struct {
 	// Storing node and expected label
 	CGraphRank rank;
     CGraphNode nodes[128];
+	// sorted nodes each edge must be adjacent to, the rows of the iterator are omitted because their edges are adjacent
+	uint64_t rows[128];
+	int rows_len;
 
     int query_type;
+	uint64_t edge_id; // id of the edge returned last by `startsymbol_neighborhood_next`
 	union {
         K2Iterator it;
         EliasFanoIterator efit;
@@ -76,4 +81,26 @@ void startsymbol_neighborhood(StartSymbolReader* s, int query_type, CGraphRank r
 // -1: error occured
 int startsymbol_neighborhood_next(StartSymbolNeighborhood* n, StEdge* edge);
 void startsymbol_neighborhood_finish(StartSymbolNeighborhood* n); // needed if not iterated to the end
+
+typedef int (*StartSymbolEdgeCallback)(const StEdge* edge, void* ctx);
+
+// Calls `cb` for all edges of the start symbol in the order of their ids.
+// In contrast to the neighborhood, the columns of all edges are determined in one traversal of the matrix.
+// If `cb` returns a negative value, the iteration is stopped. Returns 0 on success, otherwise -1.
+int startsymbol_edges(StartSymbolReader* s, StartSymbolEdgeCallback cb, void* ctx);
+
+// Decodes the edge with the id `e`. Returns 0 on success, otherwise -1.
+int startsymbol_edge(StartSymbolReader* s, uint64_t e, StEdge* edge);
+
+// Edges of the start symbol at a node, which are decoded once and shared by several queries with this node.
+typedef struct {
+	size_t len;
+	uint64_t* ids;
+	HEdge** edges;
+} StartSymbolRow;
+
+// Decodes all edges of the start symbol at the node. Returns 0 on success, otherwise -1.
+int startsymbol_row(StartSymbolReader* s, uint64_t node, StartSymbolRow* row);
+void startsymbol_row_destroy(StartSymbolRow* row);
+
 #endif
@@ -19,6 +19,18 @@
 // Default parameter if the NT table should be added
 #define DEFAULT_NT_TABLE (false)
 
+// Default number of threads used for the compression
+#define DEFAULT_THREADS 1
+
+// Default memory limit of the compression in bytes, 0 for no limit
+#define DEFAULT_MAX_MEMORY 0
+
+// Default number of partitions of the edges that are compressed independently
+#define DEFAULT_PARTITIONS 1
+
+// Default number of digrams replaced in each round of RePair
+#define DEFAULT_BATCH 1
+
 #ifdef RRR
 // Default value of bitsequences of type RRR are used
 #define DEFAULT_RRR (false)
@@ -32,6 +44,10 @@
 #define MAGIC_GRAPH "CGRAPH1\x00"
 #define MAGIC_GRAPH_LEN (strlen(MAGIC_GRAPH) + 1)
 
+// Magic number of the binary edge list file
+#define MAGIC_EDGES "CGEDGE1\x00"
+#define MAGIC_EDGES_LEN 8
+
 // Magic byte for regular bit sequences
 #define BITSEQUENCE_REGULAR 0x1
 
@@ -0,0 +1,185 @@
+/**
+ * @file reader_bench.c
+ * @author FR
+ *
+ * Benchmark for the queries of several threads on one handle of a compressed graph.
+ * First, the latency of the queries with one node is measured for all nodes of the graph in a single thread.
+ * Then these queries are run with 1, 2, 4, ... threads and the number of queries per second is printed.
+ * If no graph or an empty path is given, a random graph is created.
+ *
+ * Usage: cgraph-bench-threads [graph] [max threads] [rounds]
+ */
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <cgraph.h>
+
+#include "test_graph.h"
+
+#define BENCH_EDGES 10000
+#define BENCH_NODES 2500
+#define BENCH_SEED 42
+#define BENCH_PATH "reader_bench.cg"
+#define DEFAULT_MAX_THREADS 8
+#define DEFAULT_ROUNDS 3
+
+// number of queries a thread takes at once
+#define BENCH_CHUNK 64
+
+typedef struct {
+	CGraphR* g;
+	size_t queries; // queries of all rounds, query q asks for node q % nodes
+	size_t nodes;
+	atomic_size_t next;
+	atomic_size_t edges;
+} Bench;
+
+static void* run_thread(void* arg) {
+	Bench* b = (Bench*) arg;
+	size_t edges = 0;
+
+	size_t start;
+	while((start = atomic_fetch_add(&b->next, BENCH_CHUNK)) < b->queries) {
+		size_t end = start + BENCH_CHUNK < b->queries ? start + BENCH_CHUNK : b->queries;
+		for(size_t q = start; q < end; q++) {
+			CGraphNode n = (CGraphNode) (q % b->nodes);
+			size_t count;
+			test_graph_query(b->g, 1, &n, &count);
+			edges += count;
+		}
+	}
+
+	atomic_fetch_add(&b->edges, edges);
+	return NULL;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void* a, const void* b) {
+	double x = *((const double*) a);
+	double y = *((const double*) b);
+	return (x > y) - (x < y);
+}
+
+// Runs the queries with one node in a single thread and prints the distribution of their latency.
+static int print_latency(CGraphR* g, size_t nodes, int rounds) {
+	size_t queries = nodes * rounds;
+	double* times = malloc(queries * sizeof(*times));
+	if(!times)
+		return -1;
+
+	double sum = 0.0;
+	for(size_t q = 0; q < queries; q++) {
+		CGraphNode n = (CGraphNode) (q % nodes);
+		size_t count;
+
+		double start = now();
+		test_graph_query(g, 1, &n, &count);
+		times[q] = now() - start;
+		sum += times[q];
+	}
+
+	qsort(times, queries, sizeof(*times), cmp_double);
+	printf("latency of a query with one node in us: mean %.2f, median %.2f, p99 %.2f, max %.2f\n",
+		sum / queries * 1e6, times[queries / 2] * 1e6, times[queries * 99 / 100] * 1e6, times[queries - 1] * 1e6);
+
+	free(times);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 && *argv[1] ? argv[1] : NULL;
+	int max_threads = argc > 2 ? atoi(argv[2]) : DEFAULT_MAX_THREADS;
+	int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+	if(max_threads <= 0 || rounds <= 0) {
+		fprintf(stderr, "Usage: %s [graph] [max threads] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	TestGraph t = {0};
+	if(!path) {
+		path = BENCH_PATH;
+		if(test_graph_create(&t, path, BENCH_EDGES, BENCH_NODES, BENCH_SEED) < 0) {
+			fprintf(stderr, "Failed to create the graph \"%s\".\n", path);
+			return 1;
+		}
+	}
+
+	int res = 1;
+
+	CGraphR* g = cgraphr_init(path);
+	if(!g) {
+		fprintf(stderr, "Failed to read the graph \"%s\".\n", path);
+		goto exit_0;
+	}
+
+	pthread_t* ids = malloc(max_threads * sizeof(*ids));
+	if(!ids)
+		goto exit_1;
+
+	size_t nodes = cgraphr_node_count(g);
+	if(nodes == 0 || print_latency(g, nodes, rounds) < 0)
+		goto exit_2;
+
+	double base = 0.0;
+	size_t edges = 0;
+	printf("%8s %12s %14s %8s\n", "threads", "seconds", "queries/s", "speedup");
+	for(int threads = 1; threads <= max_threads; threads *= 2) {
+		Bench b = {
+			.g = g,
+			.queries = nodes * rounds,
+			.nodes = nodes,
+		};
+		atomic_init(&b.next, 0);
+		atomic_init(&b.edges, 0);
+
+		double start = now();
+		int started = 0;
+		for(; started < threads; started++) {
+			if(pthread_create(&ids[started], NULL, run_thread, &b) != 0)
+				break;
+		}
+		for(int i = 0; i < started; i++)
+			pthread_join(ids[i], NULL);
+		double time = now() - start;
+
+		if(started != threads) {
+			fprintf(stderr, "Failed to start %d threads.\n", threads);
+			goto exit_2;
+		}
+
+		double qps = b.queries / time;
+		if(threads == 1) {
+			base = qps;
+			edges = atomic_load(&b.edges);
+		}
+		else if(atomic_load(&b.edges) != edges) {
+			fprintf(stderr, "%d threads found %zu instead of %zu edges.\n", threads, atomic_load(&b.edges), edges);
+			goto exit_2;
+		}
+		printf("%8d %12.3f %14.0f %8.2f\n", threads, time, qps, qps / base);
+	}
+
+	res = 0;
+
+exit_2:
+	free(ids);
+exit_1:
+	cgraphr_destroy(g);
+exit_0:
+	if(t.pairs) { // the graph was created by the benchmark
+		test_graph_destroy(&t);
+		remove(path);
+	}
+	return res;
+}
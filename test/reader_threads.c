@@ -0,0 +1,164 @@
+/**
+ * @file reader_threads.c
+ * @author FR
+ *
+ * Stress test for the queries of several threads on one handle of a compressed graph.
+ * Every thread runs all queries in a different order and compares the results
+ * with the results of the same queries run by a single thread.
+ *
+ * Usage: cgraph-test-threads [graph] [threads] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include <cgraph.h>
+
+#include "test_graph.h"
+
+#define TEST_EDGES 6000
+#define TEST_NODES 1500
+#define TEST_SEED 42
+#define DEFAULT_THREADS 8
+#define DEFAULT_ROUNDS 1
+
+typedef struct {
+	CGraphR* g;
+	const TestGraph* t;
+	const uint64_t* expected; // hashes of the queries with one node, followed by the ones with two nodes
+	size_t queries;
+	int rounds;
+	uint64_t seed;
+	atomic_size_t* errors;
+} ThreadArgs;
+
+// Runs the query with the given index, the first `t->nodes` queries have one node.
+static uint64_t run_query(CGraphR* g, const TestGraph* t, size_t q, size_t* count) {
+	if(q < t->nodes) {
+		CGraphNode n = (CGraphNode) q;
+		return test_graph_query(g, 1, &n, count);
+	}
+
+	return test_graph_query(g, 2, t->pairs + 2 * (q - t->nodes), count);
+}
+
+// greatest common divisor, a step through the queries must be coprime to their number
+static size_t gcd(size_t a, size_t b) {
+	while(b) {
+		size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static void* run_thread(void* arg) {
+	ThreadArgs* a = (ThreadArgs*) arg;
+	uint64_t state = a->seed;
+
+	for(int r = 0; r < a->rounds; r++) {
+		// walk through all queries with a random start and step, so the threads query different nodes at the same time
+		size_t start = test_graph_rand(&state) % a->queries;
+		size_t step;
+		do {
+			step = 1 + test_graph_rand(&state) % a->queries;
+		} while(gcd(step, a->queries) != 1);
+
+		size_t q = start;
+		for(size_t i = 0; i < a->queries; i++) {
+			size_t count;
+			if(run_query(a->g, a->t, q, &count) != a->expected[q])
+				atomic_fetch_add(a->errors, 1);
+
+			q = (q + step) % a->queries;
+		}
+	}
+
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "reader_threads.cg";
+	int threads = argc > 2 ? atoi(argv[2]) : DEFAULT_THREADS;
+	int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+	if(threads <= 0 || rounds <= 0) {
+		fprintf(stderr, "Usage: %s [graph] [threads] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	int res = 1;
+
+	TestGraph t;
+	if(test_graph_create(&t, path, TEST_EDGES, TEST_NODES, TEST_SEED) < 0) {
+		fprintf(stderr, "Failed to create the graph \"%s\".\n", path);
+		return 1;
+	}
+
+	CGraphR* g = cgraphr_init(path);
+	if(!g) {
+		fprintf(stderr, "Failed to read the graph \"%s\".\n", path);
+		goto exit_0;
+	}
+
+	size_t queries = t.nodes + t.pair_count;
+	uint64_t* expected = malloc(queries * sizeof(*expected));
+	pthread_t* ids = malloc(threads * sizeof(*ids));
+	ThreadArgs* args = malloc(threads * sizeof(*args));
+	if(!expected || !ids || !args)
+		goto exit_1;
+
+	// results of a single thread
+	size_t edges = 0;
+	for(size_t q = 0; q < queries; q++) {
+		size_t count;
+		expected[q] = run_query(g, &t, q, &count);
+		edges += count;
+	}
+
+	if(edges == 0) {
+		fprintf(stderr, "The queries returned no edges.\n");
+		goto exit_1;
+	}
+
+	atomic_size_t errors = 0;
+	int started = 0;
+	for(; started < threads; started++) {
+		args[started] = (ThreadArgs) {
+			.g = g,
+			.t = &t,
+			.expected = expected,
+			.queries = queries,
+			.rounds = rounds,
+			.seed = TEST_SEED + started + 1,
+			.errors = &errors,
+		};
+		if(pthread_create(&ids[started], NULL, run_thread, &args[started]) != 0) {
+			fprintf(stderr, "Failed to start thread %d.\n", started);
+			break;
+		}
+	}
+
+	for(int i = 0; i < started; i++)
+		pthread_join(ids[i], NULL);
+
+	size_t e = atomic_load(&errors);
+	printf("%d threads, %d rounds, %zu queries, %zu edges: %zu mismatches\n", started, rounds, queries, edges, e);
+
+	if(started == threads && e == 0)
+		res = 0;
+
+exit_1:
+	if(expected)
+		free(expected);
+	if(ids)
+		free(ids);
+	if(args)
+		free(args);
+	cgraphr_destroy(g);
+exit_0:
+	test_graph_destroy(&t);
+	remove(path);
+	return res;
+}
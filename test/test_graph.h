@@ -0,0 +1,130 @@
+/**
+ * @file test_graph.h
+ * @author FR
+ *
+ * Helpers shared by the tests and benchmarks of the reader:
+ * creating a random compressed graph and hashing the results of queries.
+ */
+
+#ifndef TEST_GRAPH_H
+#define TEST_GRAPH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <cgraph.h>
+
+#define TEST_GRAPH_MAX_RANK 4
+
+typedef struct {
+	size_t nodes;
+	CGraphNode* pairs; // 2 nodes of every `TEST_GRAPH_PAIR_STEP`-th edge, used for queries with two nodes
+	size_t pair_count;
+} TestGraph;
+
+#define TEST_GRAPH_PAIR_STEP 7
+
+static inline uint64_t test_graph_rand(uint64_t* state) {
+	// xorshift64*, so the graphs are the same on every platform
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Nodes are chosen with a skewed distribution, so RePair finds digrams to replace.
+static inline CGraphNode test_graph_node(uint64_t* state, size_t nodes) {
+	uint64_t a = test_graph_rand(state) % nodes;
+	uint64_t b = test_graph_rand(state) % nodes;
+	return (CGraphNode) (a < b ? a : b);
+}
+
+static inline void test_graph_destroy(TestGraph* t) {
+	if(t->pairs)
+		free(t->pairs);
+}
+
+/**
+ * Creates a random graph with the given number of edges of rank 1 to `TEST_GRAPH_MAX_RANK`,
+ * compresses it with the default parameters and writes it to `path`.
+ *
+ * @return 0 on success, otherwise -1.
+ */
+static inline int test_graph_create(TestGraph* t, const char* path, size_t edges, size_t nodes, uint64_t seed) {
+	int res = -1;
+	uint64_t state = seed ? seed : 1;
+
+	t->nodes = nodes;
+	t->pair_count = 0;
+	t->pairs = malloc((edges / TEST_GRAPH_PAIR_STEP + 1) * 2 * sizeof(CGraphNode));
+	if(!t->pairs)
+		return -1;
+
+	CGraphW* g = cgraphw_init();
+	if(!g)
+		goto exit_0;
+
+	for(size_t i = 0; i < edges; i++) {
+		CGraphRank rank = 1 + (CGraphRank) (test_graph_rand(&state) % TEST_GRAPH_MAX_RANK);
+		// every label must belong to one rank, so there are two labels per rank
+		CGraphEdgeLabel label = (CGraphEdgeLabel) (rank + (test_graph_rand(&state) % 2) * TEST_GRAPH_MAX_RANK);
+		CGraphNode n[TEST_GRAPH_MAX_RANK];
+		for(CGraphRank j = 0; j < rank; j++)
+			n[j] = test_graph_node(&state, nodes);
+
+		if(cgraphw_add_edge(g, rank, label, n) < 0)
+			goto exit_1;
+
+		if(i % TEST_GRAPH_PAIR_STEP == 0) {
+			t->pairs[2 * t->pair_count] = n[0];
+			t->pairs[2 * t->pair_count + 1] = n[rank - 1];
+			t->pair_count++;
+		}
+	}
+
+	if(cgraphw_compress(g) < 0)
+		goto exit_1;
+	if(cgraphw_write(g, path, false) < 0)
+		goto exit_1;
+
+	res = 0;
+
+exit_1:
+	cgraphw_destroy(g);
+exit_0:
+	if(res < 0) {
+		free(t->pairs);
+		t->pairs = NULL;
+	}
+	return res;
+}
+
+/**
+ * Runs a query like `cgraphr_edges` and returns a hash of all edges in the order they were returned.
+ * The number of edges is written to `count`.
+ */
+static inline uint64_t test_graph_query(CGraphR* g, CGraphRank rank, const CGraphNode* nodes, size_t* count) {
+	uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+	*count = 0;
+
+	CGraphEdgeIterator* it = cgraphr_edges(g, rank, nodes, false, true);
+	if(!it)
+		return h;
+
+	CGraphEdge e;
+	while(cgraphr_edges_next(it, &e)) {
+		h = (h ^ (uint64_t) e.label) * 0x100000001b3ULL;
+		h = (h ^ (uint64_t) e.rank) * 0x100000001b3ULL;
+		for(CGraphRank i = 0; i < e.rank; i++)
+			h = (h ^ (uint64_t) e.nodes[i]) * 0x100000001b3ULL;
+
+		free(e.nodes);
+		(*count)++;
+	}
+
+	return h;
+}
+
+#endif /* TEST_GRAPH_H */